@@ -8,917 +8,5043 @@
 #include <cstring>
 #include <vector>
 #include <algorithm>
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+#include <atomic>
+#include <unordered_map>
+#include <list>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <iterator>
+#include <limits>
+#include <cmath>
+#include <cstdio>
+#include <cerrno>
+#include <system_error>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define JSON_HAS_SSE2 1
+#endif
 
-static std::string DefaultNormalize(std::string const& s) { return std::string(s); }
-static StringNormalizeFunc g_UnicodeFunc{&DefaultNormalize};
-static StringNormalizeFunc g_PathFunc{&DefaultNormalize};
+//SSSE3 code is built on any x86 compiler and only run if cpuid says so, unless the build already requires it.
+#if defined(__SSSE3__) || defined(__AVX__)
+#include <tmmintrin.h>
+#define JSON_HAS_SSSE3 1
+#define JSON_SSSE3_TARGET
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <tmmintrin.h>
+#include <cpuid.h>
+#define JSON_HAS_SSSE3 1
+#define JSON_SSSE3_CPUID 1
+#define JSON_SSSE3_TARGET __attribute__((target("ssse3")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <tmmintrin.h>
+#define JSON_HAS_SSSE3 1
+#define JSON_SSSE3_CPUID 1
+#define JSON_SSSE3_TARGET
+#endif
 
-static CScriptDictionary  * asLoadFromFile(std::string const& path)
+//same for AVX2, which is tried first.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define JSON_HAS_AVX2 1
+#define JSON_AVX2_TARGET
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#include <cpuid.h>
+#define JSON_HAS_AVX2 1
+#define JSON_AVX2_CPUID 1
+#define JSON_AVX2_TARGET __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#define JSON_HAS_AVX2 1
+#define JSON_AVX2_CPUID 1
+#define JSON_AVX2_TARGET
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+static StringNormalizeFunc g_UnicodeFunc{};
+static StringNormalizeFunc g_PathFunc{};
+static StringNormalizeViewFunc g_UnicodeViewFunc{};
+static StringNormalizeViewFunc g_PathViewFunc{};
+static size_t g_NormalizeCacheEntries{};
+static bool   g_NormalizeSkipAscii{true};
+//bumped whenever the hooks change so the per thread caches know to throw their results away.
+static std::atomic<unsigned> g_NormalizeGeneration{0};
+static JSONParseLimits g_ParseLimits;
+
+static void * DefaultAlloc(size_t size, void *) { return malloc(size); }
+static void DefaultFree(void * ptr, void *) { free(ptr); }
+static JSONAllocFunc g_AllocFunc{&DefaultAlloc};
+static JSONFreeFunc  g_FreeFunc{&DefaultFree};
+static void        * g_AllocUserData{};
+
+//mostly monotonic arena, everything is thrown away at once when the owning scope rewinds it.
+//small allocations are bumped out of blocks that grow from minBlockSize up to MaxBlockSize, anything over half of
+//minBlockSize gets an exact-size block of its own that is freed as soon as it is given back (or the scope ends).
+class JSONArena
 {
-    std::string contents;
+public:
+    struct Block;
 
-    try
+    struct Marker
+    {
+        Block  * block;
+        size_t   used;
+        uint64_t serial;
+    };
+
+    JSONArena() = default;
+    explicit JSONArena(size_t minBlockSize) : minBlockSize(minBlockSize) {}
+    JSONArena(JSONArena const&) = delete;
+    JSONArena & operator=(JSONArena const&) = delete;
+    ~JSONArena() { Release(); }
+
+    void * Allocate(size_t size, size_t align)
     {
+        if(size > minBlockSize / 2)
+            return AllocateLarge(size);
+
+        if(size >= MinFreeChunk)
+        {
+            if(void * r = TakeFree(size, align))
+                return r;
+        }
+
+        if(current)
         {
-            std::ifstream stream(g_PathFunc(std::move(path)));
+            if(void * r = current->Allocate(size, align))
+                return r;
 
-            if(!stream.is_open())
+//reuse blocks kept from an earlier call, they all hold at least minBlockSize.
+            while(current->next)
             {
-                throw std::system_error(std::make_error_code(std::errc::no_such_file_or_directory), path);
+                current = current->next;
+                current->used = 0;
+
+                if(void * r = current->Allocate(size, align))
+                    return r;
             }
+        }
 
-            stream.exceptions( std::iostream::failbit | std::iostream::badbit );
+//sized by how many blocks there are rather than by the last one, so one big burst doesn't set the size of the rest.
+        size_t capacity = minBlockSize << std::min<size_t>(blocks, 4);
+        size_t cap      = MaxBlockSize;
 
-            stream.seekg(0, std::ios::end);
-            size_t size = stream.tellg();
-            stream.seekg(0, std::ios::beg);
+        if(capacity > cap)
+            capacity = std::max(minBlockSize, cap);
+        Block * block = Block::Create(capacity);
+        ++blocks;
 
-            contents.resize(size);
-            stream.read(&contents[0], size);
-        }
+        if(current)  current->next = block;
+        else         head = block;
 
-        return asFromJSON_String(std::move(contents), asGetActiveContext()->GetEngine());
+        current = block;
+        return current->Allocate(size, align);
     }
-    catch(std::exception & e)
+
+//the most recent allocation is given back in place, large blocks are freed and other big enough buffers
+//(the old storage of a grown vector or string) are kept for the next allocation that fits.
+    void Deallocate(void * ptr, size_t size)
     {
-        asGetActiveContext()->SetException(e.what());
+        if(size > minBlockSize / 2)
+        {
+            FreeLarge(ptr);
+            return;
+        }
+
+        if(current && (char*)ptr + size == current->data() + current->used)
+        {
+            current->used -= size;
+            return;
+        }
+
+        char * begin = (char*)(((uintptr_t)ptr + alignof(FreeChunk)-1) & ~(uintptr_t)(alignof(FreeChunk)-1));
+        char * end   = (char*)ptr + size;
+
+        if(begin < end && (size_t)(end - begin) >= MinFreeChunk)
+            freeList = new(begin) FreeChunk{freeList, (size_t)(end - begin)};
     }
 
-    return nullptr;
-}
+    Marker Mark() const { return {current, current? current->used : 0, serial}; }
 
-static CScriptDictionary * asLoadFromString(const std::string & text)
-{
-    try
+    void Rewind(Marker marker)
     {
-        return asFromJSON_String(text, asGetActiveContext()->GetEngine());
+        while(large && large->serial > marker.serial)
+        {
+            Block * next = large->next;
+            large->free(large, large->userData);
+            large = next;
+        }
+
+//the free list may point past the marker, or at memory handed out since, so it starts over.
+        freeList = nullptr;
+        current  = marker.block? marker.block : head;
+
+        if(current)
+            current->used = marker.used;
+
+        if(current == head && marker.used == 0)
+            Trim();
     }
-    catch(std::exception & e)
+
+    void Release()
     {
-        asGetActiveContext()->SetException(e.what());
+        FreeChain(head);
+        FreeChain(large);
+        head = current = large = nullptr;
+        freeList = nullptr;
+        blocks = 0;
     }
 
-    return nullptr;
-}
+    static const size_t MinBlockSize = 64*1024;
+    static const size_t MaxBlockSize = 1024*1024;
+    static const size_t MaxRetained  = 16*1024*1024;
+//smaller buffers aren't worth tracking once given back.
+    static const size_t MinFreeChunk = 256;
 
-void asSaveToFile(std::string const& path, CScriptDictionary * in)
-{
-    try
+    struct Block
     {
-        std::ofstream stream(g_PathFunc(path));
-
-        if(!stream.is_open())
+        Block      * next;
+        size_t       capacity;
+        size_t       used;
+        uint64_t     serial;
+        JSONFreeFunc free;
+        void       * userData;
+
+        static Block * Create(size_t capacity)
         {
-            throw std::system_error(std::make_error_code(std::errc::no_such_file_or_directory), path);
+            void * mem = g_AllocFunc(HeaderSize() + capacity, g_AllocUserData);
+
+            if(mem == nullptr)
+                throw std::bad_alloc();
+
+            return new(mem) Block{nullptr, capacity, 0, 0, g_FreeFunc, g_AllocUserData};
         }
 
-        stream.exceptions( std::iostream::failbit | std::iostream::badbit );
+        static size_t HeaderSize() { return (sizeof(Block) + alignof(std::max_align_t)-1) & ~(alignof(std::max_align_t)-1); }
+        char * data() { return (char*)this + HeaderSize(); }
 
-        stream.imbue(std::locale("C"));
+        void * Allocate(size_t size, size_t align)
+        {
+            size_t offset = (used + align-1) & ~(align-1);
+
+            if(offset + size > capacity)
+                return nullptr;
+
+            used = offset + size;
+            return data() + offset;
+        }
+    };
+
+private:
+    struct FreeChunk
+    {
+        FreeChunk * next;
+        size_t      size;
+    };
 
-        asToJSON_String(stream, in, false);
+//newest first, so a rewind only has to look at the front of the list.
+    void * AllocateLarge(size_t size)
+    {
+        Block * block = Block::Create(size);
+        block->used   = size;
+        block->serial = ++serial;
+        block->next   = large;
+        large = block;
+        return block->data();
     }
-    catch(std::exception & e)
+
+    void FreeLarge(void * ptr)
     {
-        asGetActiveContext()->SetException(e.what());
+        for(Block ** link = &large; *link; link = &(*link)->next)
+        {
+            if((*link)->data() == ptr)
+            {
+                Block * block = *link;
+                *link = block->next;
+                block->free(block, block->userData);
+                return;
+            }
+        }
     }
-}
 
-static std::string asSaveToString(CScriptDictionary * in)
-{
-    try
+//first fit, what is left over goes back on the list if it's still worth keeping.
+    void * TakeFree(size_t size, size_t align)
     {
-        std::ostringstream stream;
+        for(FreeChunk ** link = &freeList; *link; link = &(*link)->next)
+        {
+            FreeChunk * chunk = *link;
+            char * begin = (char*)chunk;
+            char * end   = begin + chunk->size;
+            char * r     = (char*)(((uintptr_t)begin + align-1) & ~(uintptr_t)(align-1));
 
-        stream.exceptions( std::iostream::failbit | std::iostream::badbit );
+            if(r + size > end)
+                continue;
 
-        stream.imbue(std::locale("C"));
+            *link = chunk->next;
 
-        asToJSON_String(stream, in, true);
+            char * rest = (char*)(((uintptr_t)(r + size) + alignof(FreeChunk)-1) & ~(uintptr_t)(alignof(FreeChunk)-1));
 
-        return stream.str();
+            if(rest < end && (size_t)(end - rest) >= MinFreeChunk)
+                freeList = new(rest) FreeChunk{freeList, (size_t)(end - rest)};
+
+            return r;
+        }
+
+        return nullptr;
     }
-    catch(std::exception & e)
+
+//a burst of small allocations shouldn't pin its blocks to the thread forever. Large blocks are left alone,
+//an outer scope may still be using one.
+    void Trim()
     {
-        asGetActiveContext()->SetException(e.what());
+        size_t total = 0;
+        for(Block * b = head; b; b = b->next)
+            total += b->capacity;
+
+        if(total > MaxRetained)
+        {
+            FreeChain(head);
+            head = current = nullptr;
+            blocks = 0;
+        }
     }
 
-    return {};
-}
+    static void FreeChain(Block * block)
+    {
+        while(block)
+        {
+            Block * next = block->next;
+            block->free(block, block->userData);
+            block = next;
+        }
+    }
 
+    Block     * head{};
+    Block     * current{};
+//blocks of their own for large allocations, newest first.
+    Block     * large{};
+    FreeChunk * freeList{};
+    size_t      minBlockSize{MinBlockSize};
+    size_t      blocks{};
+    uint64_t    serial{};
+};
 
-void asRegisterDictionaryExtensions(asIScriptEngine * engine,  StringNormalizeFunc UnicodeNormalization, StringNormalizeFunc PathNormalization)
+template<typename T>
+struct JSONArenaAllocator
 {
-    if(UnicodeNormalization)
-        g_UnicodeFunc = UnicodeNormalization;
+    typedef T value_type;
 
-    if(PathNormalization)
-        g_PathFunc = PathNormalization;
+    JSONArenaAllocator(JSONArena & arena) : arena(&arena) {}
+    template<typename U>
+    JSONArenaAllocator(JSONArenaAllocator<U> const& it) : arena(it.arena) {}
 
-    int r;
-    r = engine->SetDefaultNamespace("dictionary"); assert(r >= 0);
+    T  * allocate(size_t n) { return (T*)arena->Allocate(n * sizeof(T), alignof(T)); }
+    void deallocate(T * p, size_t n) { arena->Deallocate(p, n * sizeof(T)); }
 
-    r = engine->RegisterGlobalFunction("dictionary@ FromJsonFile(const string &in)", asFUNCTION(asLoadFromFile), asCALL_CDECL); assert(r >= 0);
-    r = engine->RegisterGlobalFunction("dictionary@ FromJsonString(const string &in)", asFUNCTION(asLoadFromString), asCALL_CDECL); assert(r >= 0);
+    template<typename U> bool operator==(JSONArenaAllocator<U> const& it) const { return arena == it.arena; }
+    template<typename U> bool operator!=(JSONArenaAllocator<U> const& it) const { return arena != it.arena; }
 
-    r = engine->SetDefaultNamespace(""); assert(r >= 0);
+    JSONArena * arena;
+};
 
-    r = engine->RegisterObjectMethod("dictionary", "void toJsonFile(const string &in)", asFUNCTION(asSaveToFile), asCALL_CDECL_OBJLAST); assert(r >= 0);
-    r = engine->RegisterObjectMethod("dictionary", "string toJsonString()", asFUNCTION(asSaveToString), asCALL_CDECL_OBJLAST); assert(r >= 0);
+template<typename T>
+using JSONVector = std::vector<T, JSONArenaAllocator<T> >;
+typedef std::basic_string<char, std::char_traits<char>, JSONArenaAllocator<char> > JSONString;
+
+static JSONArena & GetScratchArena()
+{
+    static thread_local JSONArena arena;
+    return arena;
 }
 
+//everything allocated from the thread's arena while this is alive is freed when it goes out of scope.
+struct JSONScratchScope
+{
+    JSONScratchScope() : arena(GetScratchArena()), marker(arena.Mark()) {}
+    ~JSONScratchScope() { arena.Rewind(marker); }
 
-static bool asToJSON_String(std::vector<void const*> & object_stack,std::ostream & stream, CScriptDictionary const* dict, int depth, std::string indent, bool compressWhitespace);
-static bool asToJSON_String(std::vector<void const*> & object_stack, std::ostream & stream, CScriptArray const* array, int depth, std::string indent, bool compressWhitespace);
-static bool asToJSON_String(std::vector<void const*> & object_stack,std::ostream & stream, const char * field, int typeId, void const* object, int depth, std::string indent, bool compressWhitespace);
-static bool asToJSON_String(std::vector<void const*> & object_stack,std::ostream & stream, int typeId, void const* object, int depth, std::string indent, bool compressWhitespace);
-static bool CanSerialize(asIScriptEngine * engine, int asTypeId);
-static std::string EscapeString(std::string s);
+    JSONArena      & arena;
+    JSONArena::Marker marker;
+};
 
+void asSetJSONAllocator(JSONAllocFunc alloc, JSONFreeFunc free, void * userData)
+{
+    g_AllocFunc     = alloc? alloc : &DefaultAlloc;
+    g_FreeFunc      = alloc? free  : &DefaultFree;
+    g_AllocUserData = alloc? userData : nullptr;
+}
 
-bool CanSerializeArray(std::vector<void const*> stack, asIScriptEngine * engine, CScriptArray const* dict);
-bool CanSerializeDictionary(std::vector<void const*> stack, asIScriptEngine * engine, CScriptDictionary const* dict);
+void asReleaseJSONScratch()
+{
+    GetScratchArena().Release();
+}
 
+static void CheckLimits(JSONParseLimits const& limits)
+{
+    if(limits.maxDepth == 0 || limits.maxDepth > JSONParseLimits::maxSupportedDepth)
+        throw std::invalid_argument("maxDepth must be between 1 and " + std::to_string(JSONParseLimits::maxSupportedDepth));
+}
 
-bool CanSerializeDictionary(CScriptDictionary const* dict)
+//for the recursive walks over values that were built in script rather than parsed.
+static void CheckDepth(size_t depth)
 {
-    std::vector<void const*> stack;
-    return CanSerializeDictionary(stack, dict->GetEngine(), dict);
+    if(depth > g_ParseLimits.maxDepth)
+        throw std::runtime_error("nested deeper than " + std::to_string(g_ParseLimits.maxDepth));
 }
 
-bool CanSerializeRecursive(std::vector<void const*> stack, asIScriptEngine * engine, int typeId, void const* ref)
+void asSetJSONParseLimits(JSONParseLimits const& limits)
 {
-    if((typeId & asTYPEID_MASK_SEQNBR) == typeId
-	|| typeId == engine->GetStringFactory(nullptr, nullptr))
-        return true;
+    CheckLimits(limits);
+    g_ParseLimits = limits;
+}
 
-    auto typeInfo = engine->GetTypeInfoById(typeId);
+JSONParseLimits asGetJSONParseLimits()
+{
+    return g_ParseLimits;
+}
 
-    if(typeInfo->GetFlags() & asOBJ_POD)
-        return true;
+static CScriptDictionary * asFromJSON_Buffer(char * data, size_t size, asIScriptEngine * engine, JSONParseLimits const& limits);
+static bool asFromJSON_Into(char * data, size_t size, asIScriptEngine * engine, void * ref, int typeId, JSONParseLimits const& limits);
+static std::string const& NormalizePath(std::string const& path, std::string & scratch);
+static CScriptDictionary * asLoadCachedFile(std::string const& path, asIScriptEngine * engine, bool shared);
+
+static const asPWORD JSON_PROPERTY_PLAN = 0x4A534F50;
+struct JSONPropertyPlan;
+static JSONPropertyPlan const& GetPropertyPlan(asITypeInfo * typeInfo);
+static void FreePropertyPlan(asITypeInfo * typeInfo);
+static JSONString GetFullTypeName(asIScriptEngine * engine, int typeId, JSONArena & arena);
+
+struct JSONLoadRequest;
+static JSONLoadRequest * asLoadFromFileAsync(std::string const& path);
+static CScriptArray * asLoadFromFiles(CScriptArray const* paths);
+static CScriptArray * asLoadFromFilesWithErrors(CScriptArray const* paths, CScriptArray * errors);
+static void asLoadRequestAddRef(JSONLoadRequest * request);
+static void asLoadRequestRelease(JSONLoadRequest * request);
+static bool asLoadRequestIsReady(JSONLoadRequest const* request);
+static CScriptDictionary * asLoadRequestGet(JSONLoadRequest * request);
+static std::string asLoadRequestError(JSONLoadRequest const* request);
+
+static void CheckDocumentSize(size_t size, JSONParseLimits const& limits)
+{
+    if(limits.maxBytes && size > limits.maxBytes)
+        throw std::runtime_error("document is " + std::to_string(size) + " bytes, limit is " + std::to_string(limits.maxBytes));
+}
 
-    if(typeId & asTYPEID_OBJHANDLE)
-        ref = *(void**)ref;
+//reads the whole file into the arena with a 0 after it, files over the size limit fail before anything is allocated.
+static char * ReadFile(std::string const& path, JSONArena & arena, size_t & size, JSONParseLimits const& limits)
+{
+    std::ifstream stream;
+//we read the whole thing in one go, so don't let the filebuf allocate a buffer.
+    stream.rdbuf()->pubsetbuf(nullptr, 0);
+    stream.open(path);
 
-    if(strcmp(typeInfo->GetName(), "dictionary"))
+    if(!stream.is_open())
     {
-        return CanSerializeDictionary(stack, engine, reinterpret_cast<CScriptDictionary const*>(ref));
+        throw std::system_error(std::make_error_code(std::errc::no_such_file_or_directory), path);
     }
 
-    if(strcmp(typeInfo->GetName(), "array"))
-    {
-        return CanSerializeArray(stack, engine, reinterpret_cast<CScriptArray const*>(ref));
-    }
+    stream.exceptions( std::iostream::failbit | std::iostream::badbit );
 
-    return false;
+    stream.seekg(0, std::ios::end);
+    size = stream.tellg();
+    CheckDocumentSize(size, limits);
+    stream.seekg(0, std::ios::beg);
+
+    char * contents = (char*)arena.Allocate(size+1, 1);
+    stream.read(contents, size);
+    contents[size] = 0;
+
+    return contents;
 }
 
-bool CanSerializeDictionary(std::vector<void const*> stack, asIScriptEngine * engine, CScriptDictionary const* dict)
+//the tokenizer works in place, so text is copied into the arena; oversized text is refused before the copy.
+static char * CopyDocument(std::string const& text, JSONArena & arena, JSONParseLimits const& limits)
 {
-    for(auto x : stack)
-    {
-        if(x == dict)
-            return false;
-    }
+    CheckDocumentSize(text.size(), limits);
 
-    stack.push_back(dict);
+    char * contents = (char*)arena.Allocate(text.size()+1, 1);
+    memcpy(contents, text.c_str(), text.size()+1);
 
-    for(auto i = dict->begin(); i != dict->end(); ++i)
-    {
-        if(!CanSerializeRecursive(stack, engine, i.GetTypeId(), i.GetAddressOfValue()))
-        {
-            assert(stack.back() == dict);
-            stack.pop_back();
-            return false;
-        }
-    }
+    return contents;
+}
 
-    assert(stack.back() == dict);
-    stack.pop_back();
+//path is already normalized.
+static CScriptDictionary * asFromJSON_File(std::string const& path, asIScriptEngine * engine)
+{
+    JSONScratchScope scratch;
+    size_t size{};
+    char * contents = ReadFile(path, scratch.arena, size, g_ParseLimits);
 
-    return true;
+    return asFromJSON_Buffer(contents, size, engine, g_ParseLimits);
 }
 
-bool CanSerializeArray(std::vector<void const*> stack, asIScriptEngine * engine, CScriptArray const* dict)
+static CScriptDictionary  * asLoadFromFile(std::string const& path)
 {
-    for(auto x : stack)
+    try
     {
-        if(x == dict)
-            throw std::logic_error("Dictionary contains cyclic references");
+        std::string normalized;
+        return asLoadCachedFile(NormalizePath(path, normalized), asGetActiveContext()->GetEngine(), false);
     }
-
-    for(auto i = 0u; i != dict->GetSize(); ++i)
+    catch(std::exception & e)
     {
-        if(!CanSerializeRecursive(stack, engine, dict->GetElementTypeId(), dict->At(i)))
-        {
-            assert(stack.back() == dict);
-            stack.pop_back();
-            return false;
-        }
+        asGetActiveContext()->SetException(e.what());
     }
 
-    assert(stack.back() == dict);
-    stack.pop_back();
-
-    return true;
+    return nullptr;
 }
 
-void asToJSON_String(std::ostream & stream, const CScriptDictionary * dict, bool compressWhitespace)
+static CScriptDictionary  * asLoadSharedFromFile(std::string const& path)
 {
-    if(dict == nullptr)
-        return;
+    try
+    {
+        std::string normalized;
+        return asLoadCachedFile(NormalizePath(path, normalized), asGetActiveContext()->GetEngine(), true);
+    }
+    catch(std::exception & e)
+    {
+        asGetActiveContext()->SetException(e.what());
+    }
 
-    std::vector<void const*> object_stack;
-    asToJSON_String(object_stack, stream, dict, 1, compressWhitespace? " " : "\n", compressWhitespace);
-    assert(object_stack.empty());
+    return nullptr;
 }
 
-static bool asToJSON_String(std::vector<void const*> & object_stack, std::ostream & stream, CScriptDictionary const* dict, int depth, std::string indent, bool compressWhitespace)
+static void asInvalidateCache(std::string const& path)
 {
-    object_stack.push_back(dict);
-
-    if(depth) stream << indent;
-
-    if(!compressWhitespace)
-        indent.resize(depth+1, '\t');
-
-    stream << "{";
+    asInvalidateJSONFileCache(asGetActiveContext()->GetEngine(), path);
+}
 
-    bool first = true;
-    for(auto & i : *dict)
+static CScriptDictionary * asLoadFromString(const std::string & text)
+{
+    try
     {
-        if(!CanSerialize(asGetActiveContext()->GetEngine(), i.GetTypeId()))
-        {
-            continue;
-        }
-
-        if(first)
-            stream << indent;
-        else
-        {
-            if(!compressWhitespace)
-                stream << ',' << indent;
-            else
-                stream << ", ";
-        }
-
+        JSONScratchScope scratch;
+        char * contents = CopyDocument(text, scratch.arena, g_ParseLimits);
 
-        asToJSON_String(object_stack, stream, i.GetKey().c_str(), i.GetTypeId(), i.GetAddressOfValue(), depth+1, indent, compressWhitespace);
-        first = false;
+        return asFromJSON_Buffer(contents, text.size(), asGetActiveContext()->GetEngine(), g_ParseLimits);
+    }
+    catch(std::exception & e)
+    {
+        asGetActiveContext()->SetException(e.what());
     }
 
-    if(!compressWhitespace)
-        indent.resize(depth, '\t');
-
-    stream << indent << "}";
-
-    assert(object_stack.back() == dict);
-    object_stack.pop_back();
-
-    return true;
+    return nullptr;
 }
 
-static bool CanSerialize(asIScriptEngine * engine, int asTypeId)
+static bool asLoadFromFileInto(std::string const& path, void * ref, int typeId)
 {
-    if((asTypeId & asTYPEID_MASK_SEQNBR) == asTypeId)
-        return true;
-
-    auto typeInfo = engine->GetTypeInfoById(asTypeId);
-
-    if(strcmp(typeInfo->GetName(), "string") == 0
-    || strcmp(typeInfo->GetName(), "dictionary") == 0)
-        return true;
+    try
+    {
+        std::string normalized;
+        JSONScratchScope scratch;
+        size_t size{};
+        char * contents = ReadFile(NormalizePath(path, normalized), scratch.arena, size, g_ParseLimits);
 
-    if(strcmp(typeInfo->GetName(), "array") == 0)
+        return asFromJSON_Into(contents, size, asGetActiveContext()->GetEngine(), ref, typeId, g_ParseLimits);
+    }
+    catch(std::exception & e)
     {
-        return CanSerialize(engine, typeInfo->GetSubTypeId());
+        asGetActiveContext()->SetException(e.what());
     }
 
     return false;
 }
 
-
-static bool asToJSON_String(std::vector<void const*> & object_stack, std::ostream & stream, const CScriptArray * array, int depth, std::string indent, bool compressWhitespace)
+static bool asLoadFromStringInto(const std::string & text, void * ref, int typeId)
 {
-    object_stack.push_back(array);
+    try
+    {
+        JSONScratchScope scratch;
+        char * contents = CopyDocument(text, scratch.arena, g_ParseLimits);
+
+        return asFromJSON_Into(contents, text.size(), asGetActiveContext()->GetEngine(), ref, typeId, g_ParseLimits);
+    }
+    catch(std::exception & e)
+    {
+        asGetActiveContext()->SetException(e.what());
+    }
+
+    return false;
+}
+
+void asSaveToFile(std::string const& path, CScriptDictionary * in)
+{
+    try
+    {
+        std::string normalized;
+        asToJSON_File(NormalizePath(path, normalized), in, false);
+    }
+    catch(std::exception & e)
+    {
+        asGetActiveContext()->SetException(e.what());
+    }
+}
+
+static bool asSaveToFileIfChanged(std::string const& path, bool skipUnchanged, CScriptDictionary * in)
+{
+    try
+    {
+        std::string normalized;
+        return asToJSON_File(NormalizePath(path, normalized), in, skipUnchanged);
+    }
+    catch(std::exception & e)
+    {
+        asGetActiveContext()->SetException(e.what());
+    }
+
+    return false;
+}
+
+static asQWORD asJsonHash(CScriptDictionary * in)
+{
+    try
+    {
+        return asJSONHash(in, false);
+    }
+    catch(std::exception & e)
+    {
+        asGetActiveContext()->SetException(e.what());
+    }
+
+    return 0;
+}
+
+static std::string asSaveToString(CScriptDictionary * in)
+{
+    try
+    {
+        std::ostringstream stream;
+
+        stream.exceptions( std::iostream::failbit | std::iostream::badbit );
+
+        stream.imbue(std::locale("C"));
+
+        asToJSON_String(stream, in, true);
+
+        return stream.str();
+    }
+    catch(std::exception & e)
+    {
+        asGetActiveContext()->SetException(e.what());
+    }
+
+    return {};
+}
+
+static bool asSaveObjectToFile(std::string const& path, void * ref, int typeId, bool skipUnchanged)
+{
+    try
+    {
+        std::string normalized;
+        return asToJSON_File(NormalizePath(path, normalized), asGetActiveContext()->GetEngine(), ref, typeId, skipUnchanged);
+    }
+    catch(std::exception & e)
+    {
+        asGetActiveContext()->SetException(e.what());
+    }
+
+    return false;
+}
+
+static void asSaveObjectToFileAlways(std::string const& path, void * ref, int typeId)
+{
+    asSaveObjectToFile(path, ref, typeId, false);
+}
+
+static std::string asSaveObjectToString(void * ref, int typeId)
+{
+    try
+    {
+        std::ostringstream stream;
+
+        stream.exceptions( std::iostream::failbit | std::iostream::badbit );
+
+        stream.imbue(std::locale("C"));
+
+        asToJSON_String(stream, asGetActiveContext()->GetEngine(), ref, typeId, true);
+
+        return stream.str();
+    }
+    catch(std::exception & e)
+    {
+        asGetActiveContext()->SetException(e.what());
+    }
+
+    return {};
+}
+
+static std::string asDiff(CScriptDictionary const* a, CScriptDictionary const* b)
+{
+    try
+    {
+        std::ostringstream stream;
+
+        stream.exceptions( std::iostream::failbit | std::iostream::badbit );
+
+        stream.imbue(std::locale("C"));
+
+        asJSONDiff(stream, a, b);
+
+        return stream.str();
+    }
+    catch(std::exception & e)
+    {
+        asGetActiveContext()->SetException(e.what());
+    }
+
+    return {};
+}
+
+static void asApplyPatch(CScriptDictionary * dict, std::string const& patch)
+{
+    try
+    {
+        if(dict == nullptr)
+            throw std::invalid_argument("null dictionary");
+
+        asJSONApplyPatch(dict, patch);
+    }
+    catch(std::exception & e)
+    {
+        asGetActiveContext()->SetException(e.what());
+    }
+}
+
+
+void asRegisterDictionaryExtensions(asIScriptEngine * engine,  StringNormalizeFunc UnicodeNormalization, StringNormalizeFunc PathNormalization)
+{
+    if(UnicodeNormalization)
+        g_UnicodeFunc = UnicodeNormalization;
+
+    if(PathNormalization)
+        g_PathFunc = PathNormalization;
+
+    ++g_NormalizeGeneration;
+
+    int r;
+    engine->SetTypeInfoUserDataCleanupCallback(&FreePropertyPlan, JSON_PROPERTY_PLAN);
+
+    r = engine->RegisterObjectType("JsonLoadRequest", 0, asOBJ_REF); assert(r >= 0);
+    r = engine->RegisterObjectBehaviour("JsonLoadRequest", asBEHAVE_ADDREF, "void f()", asFUNCTION(asLoadRequestAddRef), asCALL_CDECL_OBJLAST); assert(r >= 0);
+    r = engine->RegisterObjectBehaviour("JsonLoadRequest", asBEHAVE_RELEASE, "void f()", asFUNCTION(asLoadRequestRelease), asCALL_CDECL_OBJLAST); assert(r >= 0);
+    r = engine->RegisterObjectMethod("JsonLoadRequest", "bool isReady() const", asFUNCTION(asLoadRequestIsReady), asCALL_CDECL_OBJLAST); assert(r >= 0);
+    r = engine->RegisterObjectMethod("JsonLoadRequest", "dictionary@ get()", asFUNCTION(asLoadRequestGet), asCALL_CDECL_OBJLAST); assert(r >= 0);
+    r = engine->RegisterObjectMethod("JsonLoadRequest", "string error() const", asFUNCTION(asLoadRequestError), asCALL_CDECL_OBJLAST); assert(r >= 0);
+
+    r = engine->SetDefaultNamespace("dictionary"); assert(r >= 0);
+
+    r = engine->RegisterGlobalFunction("dictionary@ FromJsonFile(const string &in)", asFUNCTION(asLoadFromFile), asCALL_CDECL); assert(r >= 0);
+    r = engine->RegisterGlobalFunction("JsonLoadRequest@ FromJsonFileAsync(const string &in)", asFUNCTION(asLoadFromFileAsync), asCALL_CDECL); assert(r >= 0);
+    r = engine->RegisterGlobalFunction("array<dictionary@>@ FromJsonFiles(const array<string> &in)", asFUNCTION(asLoadFromFiles), asCALL_CDECL); assert(r >= 0);
+    r = engine->RegisterGlobalFunction("array<dictionary@>@ FromJsonFiles(const array<string> &in, array<string> &out errors)", asFUNCTION(asLoadFromFilesWithErrors), asCALL_CDECL); assert(r >= 0);
+    r = engine->RegisterGlobalFunction("const dictionary@ FromJsonFileShared(const string &in)", asFUNCTION(asLoadSharedFromFile), asCALL_CDECL); assert(r >= 0);
+    r = engine->RegisterGlobalFunction("void InvalidateJsonCache(const string &in path = \"\")", asFUNCTION(asInvalidateCache), asCALL_CDECL); assert(r >= 0);
+    r = engine->RegisterGlobalFunction("dictionary@ FromJsonString(const string &in)", asFUNCTION(asLoadFromString), asCALL_CDECL); assert(r >= 0);
+    r = engine->RegisterGlobalFunction("bool FromJsonFile(const string &in, ?&out)", asFUNCTION(asLoadFromFileInto), asCALL_CDECL); assert(r >= 0);
+    r = engine->RegisterGlobalFunction("bool FromJsonString(const string &in, ?&out)", asFUNCTION(asLoadFromStringInto), asCALL_CDECL); assert(r >= 0);
+    r = engine->RegisterGlobalFunction("void toJsonFile(const string &in, const ?&in)", asFUNCTION(asSaveObjectToFileAlways), asCALL_CDECL); assert(r >= 0);
+    r = engine->RegisterGlobalFunction("bool toJsonFile(const string &in, const ?&in, bool skipUnchanged)", asFUNCTION(asSaveObjectToFile), asCALL_CDECL); assert(r >= 0);
+    r = engine->RegisterGlobalFunction("string toJsonString(const ?&in)", asFUNCTION(asSaveObjectToString), asCALL_CDECL); assert(r >= 0);
+    r = engine->RegisterGlobalFunction("string diff(const dictionary@+ a, const dictionary@+ b)", asFUNCTION(asDiff), asCALL_CDECL); assert(r >= 0);
+    r = engine->RegisterGlobalFunction("void applyPatch(dictionary@+, const string &in)", asFUNCTION(asApplyPatch), asCALL_CDECL); assert(r >= 0);
+
+    r = engine->SetDefaultNamespace(""); assert(r >= 0);
+
+    r = engine->RegisterObjectMethod("dictionary", "void toJsonFile(const string &in)", asFUNCTION(asSaveToFile), asCALL_CDECL_OBJLAST); assert(r >= 0);
+    r = engine->RegisterObjectMethod("dictionary", "bool toJsonFile(const string &in, bool skipUnchanged)", asFUNCTION(asSaveToFileIfChanged), asCALL_CDECL_OBJLAST); assert(r >= 0);
+    r = engine->RegisterObjectMethod("dictionary", "uint64 jsonHash() const", asFUNCTION(asJsonHash), asCALL_CDECL_OBJLAST); assert(r >= 0);
+    r = engine->RegisterObjectMethod("dictionary", "string toJsonString()", asFUNCTION(asSaveToString), asCALL_CDECL_OBJLAST); assert(r >= 0);
+}
+
+
+typedef JSONVector<void const*> JSONObjectStack;
+
+//everything needed to write an instance of one type, built once and kept in the type's user data.
+struct JSONPropertyPlan
+{
+    struct Property
+    {
+        std::string name;
+//"name": with the name already escaped.
+        std::string key;
+        int         typeId;
+        int         offset;
+//the object only holds a pointer to the value, handles are dereferenced by the writer instead.
+        bool        indirect;
+
+        void const* Address(void const* object) const
+        {
+            char const* address = (char const*)object + offset;
+            return indirect? *(void const* const*)address : address;
+        }
+    };
+
+//value types can't form cycles, and a member at offset 0 would look like one, so only reference types go on the object stack.
+    bool reference;
+//g_NormalizeGeneration the keys were escaped under, they're only used while it's still current.
+    unsigned generation;
+//declaration order, anything CanSerialize rejects is left out.
+    std::vector<Property> properties;
+//indices into properties ordered by name, for matching keys when reading.
+    std::vector<uint32_t> byName;
+
+    Property const* Find(const char * name, size_t length) const
+    {
+        auto itr = std::lower_bound(byName.begin(), byName.end(), 0u, [&](uint32_t i, uint32_t)
+        {
+            return properties[i].name.compare(0, std::string::npos, name, length) < 0;
+        });
+
+        if(itr == byName.end() || properties[*itr].name.compare(0, std::string::npos, name, length) != 0)
+            return nullptr;
+
+        return &properties[*itr];
+    }
+};
+
+static bool asToJSON_String(JSONObjectStack & object_stack,std::ostream & stream, CScriptDictionary const* dict, int depth, int indent, bool compressWhitespace);
+static bool asToJSON_String(JSONObjectStack & object_stack, std::ostream & stream, CScriptArray const* array, int depth, int indent, bool compressWhitespace);
+static bool asToJSON_String(JSONObjectStack & object_stack,std::ostream & stream, asIScriptEngine * engine, std::string const& field, int typeId, void const* object, int depth, int indent, bool compressWhitespace);
+static bool asToJSON_String(JSONObjectStack & object_stack,std::ostream & stream, asIScriptEngine * engine, int typeId, void const* object, int depth, int indent, bool compressWhitespace);
+static bool CanSerialize(asIScriptEngine * engine, int asTypeId);
+static void WriteEscapedString(std::ostream & stream, std::string const& s);
+static bool asToJSON_String(JSONObjectStack & object_stack, std::ostream & stream, asIScriptEngine * engine, JSONPropertyPlan const& plan, void const* object, int depth, int indent, bool compressWhitespace);
+
+
+bool CanSerializeArray(JSONObjectStack & stack, asIScriptEngine * engine, CScriptArray const* dict);
+bool CanSerializeDictionary(JSONObjectStack & stack, asIScriptEngine * engine, CScriptDictionary const* dict);
+bool CanSerializeObject(JSONObjectStack & stack, asIScriptEngine * engine, JSONPropertyPlan const& plan, void const* object);
+
+
+bool CanSerializeDictionary(CScriptDictionary const* dict)
+{
+    JSONScratchScope scratch;
+    JSONObjectStack stack(scratch.arena);
+    return CanSerializeDictionary(stack, dict->GetEngine(), dict);
+}
+
+bool CanSerializeRecursive(JSONObjectStack & stack, asIScriptEngine * engine, int typeId, void const* ref)
+{
+    if((typeId & asTYPEID_MASK_SEQNBR) == typeId
+	|| typeId == engine->GetStringFactory(nullptr, nullptr))
+        return true;
+
+    auto typeInfo = engine->GetTypeInfoById(typeId);
+
+    if(typeInfo->GetFlags() & asOBJ_POD)
+        return true;
+
+    if(typeId & asTYPEID_OBJHANDLE)
+        ref = *(void**)ref;
+
+    if(ref == nullptr)
+        return true;
+
+    if(strcmp(typeInfo->GetName(), "dictionary") == 0)
+    {
+        return CanSerializeDictionary(stack, engine, reinterpret_cast<CScriptDictionary const*>(ref));
+    }
+
+    if(strcmp(typeInfo->GetName(), "array") == 0)
+    {
+        return CanSerializeArray(stack, engine, reinterpret_cast<CScriptArray const*>(ref));
+    }
+
+    if(typeId & asTYPEID_SCRIPTOBJECT)
+    {
+        auto object = reinterpret_cast<asIScriptObject const*>(ref);
+        return CanSerializeObject(stack, engine, GetPropertyPlan(object->GetObjectType()), ref);
+    }
+
+    if(CanSerialize(engine, typeId))
+    {
+        return CanSerializeObject(stack, engine, GetPropertyPlan(typeInfo), ref);
+    }
+
+    return false;
+}
+
+bool CanSerializeDictionary(JSONObjectStack & stack, asIScriptEngine * engine, CScriptDictionary const* dict)
+{
+    for(auto x : stack)
+    {
+        if(x == dict)
+            return false;
+    }
+
+    CheckDepth(stack.size()+1);
+    stack.push_back(dict);
+
+    for(auto i = dict->begin(); i != dict->end(); ++i)
+    {
+        if(!CanSerializeRecursive(stack, engine, i.GetTypeId(), i.GetAddressOfValue()))
+        {
+            assert(stack.back() == dict);
+            stack.pop_back();
+            return false;
+        }
+    }
+
+    assert(stack.back() == dict);
+    stack.pop_back();
+
+    return true;
+}
+
+bool CanSerializeArray(JSONObjectStack & stack, asIScriptEngine * engine, CScriptArray const* dict)
+{
+    for(auto x : stack)
+    {
+        if(x == dict)
+            throw std::logic_error("Dictionary contains cyclic references");
+    }
+
+    CheckDepth(stack.size()+1);
+    stack.push_back(dict);
+
+    for(auto i = 0u; i != dict->GetSize(); ++i)
+    {
+        if(!CanSerializeRecursive(stack, engine, dict->GetElementTypeId(), dict->At(i)))
+        {
+            assert(stack.back() == dict);
+            stack.pop_back();
+            return false;
+        }
+    }
+
+    assert(stack.back() == dict);
+    stack.pop_back();
+
+    return true;
+}
+
+bool CanSerializeObject(JSONObjectStack & stack, asIScriptEngine * engine, JSONPropertyPlan const& plan, void const* object)
+{
+    if(plan.reference)
+    {
+        for(auto x : stack)
+        {
+            if(x == object)
+                return false;
+        }
+
+        CheckDepth(stack.size()+1);
+        stack.push_back(object);
+    }
+
+    bool r = true;
+
+    for(auto & property : plan.properties)
+    {
+        if(!CanSerializeRecursive(stack, engine, property.typeId, property.Address(object)))
+        {
+            r = false;
+            break;
+        }
+    }
+
+    if(plan.reference)
+    {
+        assert(stack.back() == object);
+        stack.pop_back();
+    }
+
+    return r;
+}
+
+//indent is the length the old indent string would have had: a newline followed by indent-1 tabs.
+static void WriteIndent(std::ostream & stream, int indent, bool compressWhitespace)
+{
+    static const char tabs[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+
+    if(compressWhitespace)
+    {
+        stream.put(' ');
+        return;
+    }
+
+    stream.put('\n');
+
+    for(int n = indent-1; n > 0; n -= (int)(sizeof(tabs)-1))
+        stream.write(tabs, std::min<int>(n, sizeof(tabs)-1));
+}
+
+void asToJSON_String(std::ostream & stream, const CScriptDictionary * dict, bool compressWhitespace)
+{
+    if(dict == nullptr)
+        return;
+
+    JSONScratchScope scratch;
+    JSONObjectStack object_stack(scratch.arena);
+    asToJSON_String(object_stack, stream, dict, 1, 1, compressWhitespace);
+    assert(object_stack.empty());
+}
+
+//a document has to be a JSON object: a dictionary, a script object or a value type with registered properties.
+static void CheckDocumentRoot(asIScriptEngine * engine, void const* ref, int typeId)
+{
+    void const* object = (typeId & asTYPEID_OBJHANDLE)? *(void const* const*)ref : ref;
+    auto typeInfo = (typeId & asTYPEID_MASK_OBJECT)? engine->GetTypeInfoById(typeId) : nullptr;
+
+    if(typeInfo == nullptr
+    || (strcmp(typeInfo->GetName(), "dictionary") != 0 && !(typeId & asTYPEID_SCRIPTOBJECT)
+        && !((typeInfo->GetFlags() & asOBJ_VALUE) && !GetPropertyPlan(typeInfo).properties.empty())))
+        throw std::invalid_argument(std::string(GetFullTypeName(engine, typeId, GetScratchArena()).c_str()) + " can't be written as a JSON document");
+
+    if(object == nullptr)
+        throw std::invalid_argument("null handle");
+}
+
+void asToJSON_String(std::ostream & stream, asIScriptEngine * engine, void const* ref, int typeId, bool compressWhitespace)
+{
+    CheckDocumentRoot(engine, ref, typeId);
+
+    JSONScratchScope scratch;
+    JSONObjectStack object_stack(scratch.arena);
+    asToJSON_String(object_stack, stream, engine, typeId, ref, 1, 1, compressWhitespace);
+    assert(object_stack.empty());
+}
+
+static bool asToJSON_String(JSONObjectStack & object_stack, std::ostream & stream, CScriptDictionary const* dict, int depth, int indent, bool compressWhitespace)
+{
+    CheckDepth(object_stack.size()+1);
+    object_stack.push_back(dict);
+
+    if(depth) WriteIndent(stream, indent, compressWhitespace);
+
+    indent = depth+1;
+
+    stream << "{";
+
+    bool first = true;
+    for(auto & i : *dict)
+    {
+        if(!CanSerialize(dict->GetEngine(), i.GetTypeId()))
+        {
+            continue;
+        }
+
+        if(first)
+            WriteIndent(stream, indent, compressWhitespace);
+        else
+        {
+            if(!compressWhitespace)
+            {
+                stream << ',';
+                WriteIndent(stream, indent, compressWhitespace);
+            }
+            else
+                stream << ", ";
+        }
+
+
+        asToJSON_String(object_stack, stream, dict->GetEngine(), i.GetKey(), i.GetTypeId(), i.GetAddressOfValue(), depth+1, indent, compressWhitespace);
+        first = false;
+    }
+
+    WriteIndent(stream, depth, compressWhitespace);
+    stream << "}";
+
+    assert(object_stack.back() == dict);
+    object_stack.pop_back();
+
+    return true;
+}
+
+static bool CanSerialize(asIScriptEngine * engine, int asTypeId)
+{
+    if((asTypeId & asTYPEID_MASK_SEQNBR) == asTypeId)
+        return true;
+
+    auto typeInfo = engine->GetTypeInfoById(asTypeId);
+
+    if(strcmp(typeInfo->GetName(), "string") == 0
+    || strcmp(typeInfo->GetName(), "dictionary") == 0)
+        return true;
+
+    if(strcmp(typeInfo->GetName(), "array") == 0)
+    {
+        return CanSerialize(engine, typeInfo->GetSubTypeId());
+    }
+
+//script classes are written property by property, registered value types too if they registered any.
+    if(asTypeId & asTYPEID_SCRIPTOBJECT)
+        return true;
+
+    if(typeInfo->GetFlags() & asOBJ_VALUE)
+        return !GetPropertyPlan(typeInfo).properties.empty();
+
+    return false;
+}
+
+
+static bool asToJSON_String(JSONObjectStack & object_stack, std::ostream & stream, const CScriptArray * array, int depth, int indent, bool compressWhitespace)
+{
+    CheckDepth(object_stack.size()+1);
+    object_stack.push_back(array);
+
+    bool r = false;
+
+    indent = depth;
+
+    stream << "[";
+
+    for(asUINT i = 0; i != array->GetSize(); ++i)
+    {
+        if(i != 0)
+        {
+                stream << ", ";
+        }
+
+        r |= asToJSON_String(object_stack, stream, array->GetArrayObjectType()->GetEngine(), array->GetElementTypeId(), array->At(i), depth, indent, compressWhitespace);
+    }
+
+    stream << "]";
+
+
+    assert(object_stack.back() == array);
+    object_stack.pop_back();
+
+    return r;
+}
+
+static bool asToJSON_String(JSONObjectStack & object_stack, std::ostream & stream, asIScriptEngine * engine, std::string const& field, int typeId, void const* object, int depth, int indent, bool compressWhitespace)
+{
+    stream << "\"";
+    WriteEscapedString(stream, field);
+    stream << "\": ";
+    return asToJSON_String(object_stack, stream, engine, typeId, object, depth, indent, compressWhitespace);
+}
+
+
+static bool asToJSON_String(JSONObjectStack & object_stack, std::ostream & stream, asIScriptEngine * engine, int typeId, void const* object, int depth, int indent, bool compressWhitespace)
+{
+    if(typeId & asTYPEID_OBJHANDLE && object)
+    {
+        object = *(void**)object;
+    }
+
+    if(object == nullptr)
+    {
+        stream << "null";
+        return false;
+    }
+
+    for(auto & c : object_stack)
+    {
+        if(c == object)
+        {
+            stream << "null";
+            return false;
+        }
+    }
+
+    stream.setf(std::ios::fixed,std::ios::floatfield);
+
+    switch(typeId)
+    {
+    case asTYPEID_VOID:   stream << "null"; return false;
+    case asTYPEID_BOOL:   stream <<((*(const bool*)object)? "true" : "false"); return false;
+    case asTYPEID_INT8:   stream << *(const int8_t*)object; return false;
+    case asTYPEID_INT16:  stream << *(const  int16_t*)object; return false;
+    case asTYPEID_INT32:  stream << *(const  int32_t*)object; return false;
+    case asTYPEID_INT64:  stream << *(const  int64_t*)object; return false;
+    case asTYPEID_UINT8:  stream << *(const uint8_t*)object; return false;
+    case asTYPEID_UINT16: stream << *(const uint16_t*)object; return false;
+    case asTYPEID_UINT32: stream << *(const uint32_t*)object; return false;
+    case asTYPEID_UINT64: stream << *(const uint64_t*)object; return false;
+    case asTYPEID_FLOAT:
+    {
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), "%g", *(const float*)object);
+
+        stream << buffer;
+        return false;
+    }
+    case asTYPEID_DOUBLE:
+    {
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), "%lg", *(const double*)object);
+
+        stream << buffer;
+        return false;
+    }
+    default:
+        break;
+    }
+
+    auto typeInfo = engine->GetTypeInfoById(typeId);
+
+    if((typeId & asTYPEID_MASK_SEQNBR) == typeId)
+    {
+        auto N = typeInfo->GetEnumValueCount();
+        for(auto i = 0u; i < N; ++i)
+        {
+            int enumValue = 0;
+            const char * name = typeInfo->GetEnumValueByIndex(i, &enumValue);
+
+            if(enumValue == *(const  int32_t*)object)
+            {
+                stream << '\"' << name << '\"';
+                return false;
+            }
+        }
+
+        stream << *(const  int32_t*)object;
+        return false;
+    }
+
+    if(strcmp(typeInfo->GetName(), "string") == 0)
+    {
+        stream << '\"';
+        WriteEscapedString(stream, *(std::string*)object);
+        stream << '\"';
+        return false;
+    }
+
+    if(strcmp(typeInfo->GetName(), "dictionary") == 0)
+    {
+        return asToJSON_String(object_stack, stream, (CScriptDictionary*)object, depth, indent, compressWhitespace);
+    }
+
+    if(strcmp(typeInfo->GetName(), "array") == 0)
+    {
+        return asToJSON_String(object_stack, stream, (CScriptArray*)object, depth, indent, compressWhitespace);
+    }
+
+    if(strcmp(typeInfo->GetName(), "dictionaryValue") == 0)
+    {
+        auto & value = *(CScriptDictValue*)object;
+        return asToJSON_String(object_stack, stream, engine, value.GetTypeId(), value.GetAddressOfValue(), depth, indent, compressWhitespace);
+    }
+
+//go by the instance's own type, the handle may be to a base class or interface.
+    if(typeId & asTYPEID_SCRIPTOBJECT)
+    {
+        auto script_object = (asIScriptObject const*)object;
+        return asToJSON_String(object_stack, stream, engine, GetPropertyPlan(script_object->GetObjectType()), object, depth, indent, compressWhitespace);
+    }
+
+    if(typeInfo->GetFlags() & asOBJ_VALUE)
+    {
+        auto & plan = GetPropertyPlan(typeInfo);
+
+        if(!plan.properties.empty())
+            return asToJSON_String(object_stack, stream, engine, plan, object, depth, indent, compressWhitespace);
+    }
+
+    return false;
+}
+
+/* property plans for script classes and registered value types */
+
+void FreePropertyPlan(asITypeInfo * typeInfo)
+{
+    delete (JSONPropertyPlan*)typeInfo->GetUserData(JSON_PROPERTY_PLAN);
+}
+
+//recursive because building a plan asks CanSerialize about value type members, which builds theirs.
+static std::recursive_mutex g_PropertyPlanMutex;
+
+//built once per type and then only read, so the lock is only taken while the type has none yet.
+JSONPropertyPlan const& GetPropertyPlan(asITypeInfo * typeInfo)
+{
+    if(auto plan = (JSONPropertyPlan const*)typeInfo->GetUserData(JSON_PROPERTY_PLAN))
+        return *plan;
+
+    std::lock_guard<std::recursive_mutex> lock(g_PropertyPlanMutex);
+
+    if(auto plan = (JSONPropertyPlan const*)typeInfo->GetUserData(JSON_PROPERTY_PLAN))
+        return *plan;
+
+    asIScriptEngine * engine = typeInfo->GetEngine();
+    auto plan = new JSONPropertyPlan;
+    plan->reference  = (typeInfo->GetFlags() & asOBJ_REF) != 0;
+    plan->generation = g_NormalizeGeneration;
+
+    asUINT N = typeInfo->GetPropertyCount();
+    plan->properties.reserve(N);
+
+    for(asUINT i = 0; i < N; ++i)
+    {
+        const char * name{};
+        int typeId{};
+        int offset{};
+        bool isReference{};
+
+        if(typeInfo->GetProperty(i, &name, &typeId, nullptr, nullptr, &offset, &isReference) < 0
+        || !CanSerialize(engine, typeId))
+            continue;
+
+//same rule asIScriptObject::GetAddressOfProperty uses.
+        bool indirect = (typeId & asTYPEID_MASK_OBJECT) && !(typeId & asTYPEID_OBJHANDLE)
+            && (isReference || (engine->GetTypeInfoById(typeId)->GetFlags() & asOBJ_REF));
+
+        std::ostringstream key;
+        key << '\"';
+        WriteEscapedString(key, name);
+        key << "\": ";
+
+        plan->properties.push_back({name, key.str(), typeId, offset, indirect});
+    }
+
+    for(uint32_t i = 0; i < plan->properties.size(); ++i)
+        plan->byName.push_back(i);
+
+    std::sort(plan->byName.begin(), plan->byName.end(), [plan](uint32_t a, uint32_t b)
+    {
+        return plan->properties[a].name < plan->properties[b].name;
+    });
+
+    typeInfo->SetUserData(plan, JSON_PROPERTY_PLAN);
+    return *plan;
+}
+
+static bool asToJSON_String(JSONObjectStack & object_stack, std::ostream & stream, asIScriptEngine * engine, JSONPropertyPlan const& plan, void const* object, int depth, int indent, bool compressWhitespace)
+{
+    if(plan.reference)
+    {
+        CheckDepth(object_stack.size()+1);
+        object_stack.push_back(object);
+    }
+
+    if(depth) WriteIndent(stream, indent, compressWhitespace);
+
+    indent = depth+1;
+
+    stream << "{";
+
+    bool first = true;
+    for(auto & property : plan.properties)
+    {
+        if(first)
+            WriteIndent(stream, indent, compressWhitespace);
+        else
+        {
+            if(!compressWhitespace)
+            {
+                stream << ',';
+                WriteIndent(stream, indent, compressWhitespace);
+            }
+            else
+                stream << ", ";
+        }
+
+        if(plan.generation == g_NormalizeGeneration)
+            stream << property.key;
+        else
+        {
+//the normalization hooks changed after the plan was built.
+            stream << '\"';
+            WriteEscapedString(stream, property.name);
+            stream << "\": ";
+        }
+
+        asToJSON_String(object_stack, stream, engine, property.typeId, property.Address(object), depth+1, indent, compressWhitespace);
+        first = false;
+    }
+
+    WriteIndent(stream, depth, compressWhitespace);
+    stream << "}";
+
+    if(plan.reference)
+    {
+        assert(object_stack.back() == object);
+        object_stack.pop_back();
+    }
+
+    return true;
+}
+
+static inline int CountTrailingZeros(unsigned mask)
+{
+#ifdef _MSC_VER
+    unsigned long r;
+    _BitScanForward(&r, mask);
+    return (int)r;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+//first byte in [p, end) that can't go into a JSON string as is: '"', '\\' or a control character.
+static const char * FindEscapeChar(const char * p, const char * end)
+{
+#if JSON_HAS_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i slash = _mm_set1_epi8('\\');
+    const __m128i ctrl  = _mm_set1_epi8(0x1F);
+
+    for(; end - p >= 16; p += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+//max_epu8(v, 0x1F) == 0x1F only when v <= 0x1F unsigned.
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, slash)),
+                                 _mm_cmpeq_epi8(_mm_max_epu8(v, ctrl), ctrl));
+
+        if(int mask = _mm_movemask_epi8(m))
+            return p + CountTrailingZeros(mask);
+    }
+#endif
+
+    for(; p < end; ++p)
+    {
+        if(*p == '"' || *p == '\\' || (unsigned char)*p < 0x20)
+            return p;
+    }
+
+    return end;
+}
+
+//first closing quote, backslash or 0 in [p, end), this is what the tokenizer needs to find the end of a string.
+//ascii is cleared if a byte >= 0x80 was seen on the way (or just after the match), so 7 bit strings skip UTF-8 validation.
+static const char * FindQuoteOrEscape(const char * p, const char * end, char quote_char, bool & ascii)
+{
+#if JSON_HAS_SSE2
+    const __m128i quote = _mm_set1_epi8(quote_char);
+    const __m128i slash = _mm_set1_epi8('\\');
+    const __m128i zero  = _mm_setzero_si128();
+    __m128i high = _mm_setzero_si128();
+
+    for(; end - p >= 16; p += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, slash)),
+                                 _mm_cmpeq_epi8(v, zero));
+        high = _mm_or_si128(high, v);
+
+        if(int mask = _mm_movemask_epi8(m))
+        {
+            ascii = ascii && _mm_movemask_epi8(high) == 0;
+            return p + CountTrailingZeros(mask);
+        }
+    }
+
+    ascii = ascii && _mm_movemask_epi8(high) == 0;
+#endif
+
+    for(; p < end; ++p)
+    {
+        if(*p == quote_char || *p == '\\' || *p == 0)
+            return p;
+
+        ascii = ascii && (unsigned char)*p < 0x80;
+    }
+
+    return end;
+}
+
+static bool IsAscii(const char * p, const char * end)
+{
+#if JSON_HAS_SSE2
+    __m128i acc = _mm_setzero_si128();
+
+    for(; end - p >= 16; p += 16)
+        acc = _mm_or_si128(acc, _mm_loadu_si128((const __m128i*)p));
+
+    if(_mm_movemask_epi8(acc))
+        return false;
+#endif
+
+    unsigned char acc8 = 0;
+
+    for(; p < end; ++p)
+        acc8 |= (unsigned char)*p;
+
+    return acc8 < 0x80;
+}
+
+//length of the UTF-8 sequence at p, or of the invalid bytes to replace if it isn't one (Unicode's "maximal subpart").
+static int DecodeUTF8(const char * input, const char * end, bool & valid)
+{
+    const unsigned char * p = (const unsigned char*)input;
+    unsigned char lo = 0x80, hi = 0xBF;
+    int need;
+
+    if(p[0] < 0x80)
+    {
+        valid = true;
+        return 1;
+    }
+
+    if(0xC2 <= p[0] && p[0] <= 0xDF)
+        need = 1;
+    else if(0xE0 <= p[0] && p[0] <= 0xEF)
+    {
+        need = 2;
+        if(p[0] == 0xE0) lo = 0xA0;
+        if(p[0] == 0xED) hi = 0x9F;
+    }
+    else if(0xF0 <= p[0] && p[0] <= 0xF4)
+    {
+        need = 3;
+        if(p[0] == 0xF0) lo = 0x90;
+        if(p[0] == 0xF4) hi = 0x8F;
+    }
+    else
+    {
+        valid = false;
+        return 1;
+    }
+
+    for(int i = 1; i <= need; ++i)
+    {
+        if(input + i >= end || p[i] < lo || p[i] > hi)
+        {
+            valid = false;
+            return i;
+        }
+
+        lo = 0x80;
+        hi = 0xBF;
+    }
+
+    valid = true;
+    return need+1;
+}
+
+#if JSON_HAS_SSSE3 || JSON_HAS_AVX2
+//Keiser & Lemire's lookup algorithm: three table lookups per block classify every pair of bytes, the lengths are checked separately.
+enum : uint8_t
+{
+    UTF8_TOO_SHORT  = 1 << 0,
+    UTF8_TOO_LONG   = 1 << 1,
+    UTF8_OVERLONG_3 = 1 << 2,
+    UTF8_TOO_LARGE  = 1 << 3,
+    UTF8_SURROGATE  = 1 << 4,
+    UTF8_OVERLONG_2 = 1 << 5,
+    UTF8_TOO_LARGE_1000 = 1 << 6,
+    UTF8_OVERLONG_4 = 1 << 6,
+    UTF8_TWO_CONTS  = 1 << 7,
+    UTF8_CARRY = UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS,
+};
+
+//indexed by the high nibble of the first byte of each pair, then its low nibble, then the high nibble of the second byte.
+static const uint8_t g_UTF8Byte1High[16] = {
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+    UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+    UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4 };
+
+static const uint8_t g_UTF8Byte1Low[16] = {
+    UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+    UTF8_CARRY | UTF8_OVERLONG_2,
+    UTF8_CARRY,
+    UTF8_CARRY,
+    UTF8_CARRY | UTF8_TOO_LARGE,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 };
+
+static const uint8_t g_UTF8Byte2High[16] = {
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE  | UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE  | UTF8_TOO_LARGE,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT };
+
+//a lead byte this close to the end of the block needs the next block to finish it, the SSSE3 version uses the last 16.
+static const uint8_t g_UTF8IncompleteMax[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xF0-1, 0xE0-1, 0xC0-1 };
+#endif
+
+#if JSON_HAS_SSSE3
+static bool HasSSSE3()
+{
+#if JSON_SSSE3_CPUID
+//ecx bit 9 of leaf 1.
+    static const bool supported = []
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 9)) != 0;
+#else
+        unsigned eax, ebx, ecx, edx;
+        return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & (1u << 9)) != 0;
+#endif
+    }();
+
+    return supported;
+#else
+    return true;
+#endif
+}
+
+JSON_SSSE3_TARGET static bool IsValidUTF8_SSSE3(const char * p, const char * end)
+{
+    const __m128i byte_1_high_table = _mm_loadu_si128((const __m128i*)g_UTF8Byte1High);
+    const __m128i byte_1_low_table  = _mm_loadu_si128((const __m128i*)g_UTF8Byte1Low);
+    const __m128i byte_2_high_table = _mm_loadu_si128((const __m128i*)g_UTF8Byte2High);
+    const __m128i incomplete_max    = _mm_loadu_si128((const __m128i*)(g_UTF8IncompleteMax+16));
+
+    const __m128i low_nibble = _mm_set1_epi8(0x0F);
+
+    __m128i error      = _mm_setzero_si128();
+    __m128i prev       = _mm_setzero_si128();
+    __m128i incomplete = _mm_setzero_si128();
+
+    for(;;)
+    {
+        __m128i input;
+
+        if(end - p >= 16)
+            input = _mm_loadu_si128((const __m128i*)p);
+        else if(p < end)
+        {
+            char tail[16] = {};
+            memcpy(tail, p, end - p);
+            input = _mm_loadu_si128((const __m128i*)tail);
+        }
+        else
+            break;
+
+        p += 16;
+
+        if(_mm_movemask_epi8(input) == 0)
+        {
+            error = _mm_or_si128(error, incomplete);
+            incomplete = _mm_setzero_si128();
+            prev = input;
+            continue;
+        }
+
+        __m128i prev1 = _mm_alignr_epi8(input, prev, 15);
+        __m128i prev2 = _mm_alignr_epi8(input, prev, 14);
+        __m128i prev3 = _mm_alignr_epi8(input, prev, 13);
+
+        __m128i special = _mm_and_si128(_mm_and_si128(
+            _mm_shuffle_epi8(byte_1_high_table, _mm_and_si128(_mm_srli_epi16(prev1, 4), low_nibble)),
+            _mm_shuffle_epi8(byte_1_low_table, _mm_and_si128(prev1, low_nibble))),
+            _mm_shuffle_epi8(byte_2_high_table, _mm_and_si128(_mm_srli_epi16(input, 4), low_nibble)));
+
+//only third and fourth bytes of a sequence come out >= 0x80 here, and they must be continuations.
+        __m128i must23 = _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(0xE0-0x80)), _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xF0-0x80))));
+        __m128i must23_80 = _mm_and_si128(must23, _mm_set1_epi8((char)0x80));
+
+        error = _mm_or_si128(error, _mm_xor_si128(must23_80, special));
+        incomplete = _mm_subs_epu8(input, incomplete_max);
+        prev = input;
+    }
+
+    error = _mm_or_si128(error, incomplete);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+}
+#endif
+
+#if JSON_HAS_AVX2
+static bool HasAVX2()
+{
+#if JSON_AVX2_CPUID
+//ebx bit 5 of leaf 7, and the OS has to save the ymm registers: osxsave (ecx bit 27 of leaf 1) and bits 1-2 of xcr0.
+    static const bool supported = []
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 1);
+        if((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6)
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        unsigned eax, ebx, ecx, edx;
+        if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || (ecx & (1u << 27)) == 0)
+            return false;
+
+        unsigned xcr0, xcr0_hi;
+        __asm__("xgetbv" : "=a"(xcr0), "=d"(xcr0_hi) : "c"(0));
+        if((xcr0 & 6) != 6)
+            return false;
+
+        return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1u << 5)) != 0;
+#endif
+    }();
+
+    return supported;
+#else
+    return true;
+#endif
+}
+
+//the SSSE3 version on 32 bytes, the shuffles work per 128 bit lane so the tables are in both.
+JSON_AVX2_TARGET static bool IsValidUTF8_AVX2(const char * p, const char * end)
+{
+    const __m256i byte_1_high_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)g_UTF8Byte1High));
+    const __m256i byte_1_low_table  = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)g_UTF8Byte1Low));
+    const __m256i byte_2_high_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)g_UTF8Byte2High));
+    const __m256i incomplete_max    = _mm256_loadu_si256((const __m256i*)g_UTF8IncompleteMax);
+
+    const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+
+    __m256i error      = _mm256_setzero_si256();
+    __m256i prev       = _mm256_setzero_si256();
+    __m256i incomplete = _mm256_setzero_si256();
+
+    for(;;)
+    {
+        __m256i input;
+
+        if(end - p >= 32)
+            input = _mm256_loadu_si256((const __m256i*)p);
+        else if(p < end)
+        {
+            char tail[32] = {};
+            memcpy(tail, p, end - p);
+            input = _mm256_loadu_si256((const __m256i*)tail);
+        }
+        else
+            break;
+
+        p += 32;
+
+        if(_mm256_movemask_epi8(input) == 0)
+        {
+            error = _mm256_or_si256(error, incomplete);
+            incomplete = _mm256_setzero_si256();
+            prev = input;
+            continue;
+        }
+
+//alignr doesn't cross lanes either: the low lane continues from the high lane of prev, the high lane from the low lane of input.
+        __m256i carried = _mm256_permute2x128_si256(prev, input, 0x21);
+        __m256i prev1 = _mm256_alignr_epi8(input, carried, 15);
+        __m256i prev2 = _mm256_alignr_epi8(input, carried, 14);
+        __m256i prev3 = _mm256_alignr_epi8(input, carried, 13);
+
+        __m256i special = _mm256_and_si256(_mm256_and_si256(
+            _mm256_shuffle_epi8(byte_1_high_table, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble)),
+            _mm256_shuffle_epi8(byte_1_low_table, _mm256_and_si256(prev1, low_nibble))),
+            _mm256_shuffle_epi8(byte_2_high_table, _mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibble)));
+
+        __m256i must23 = _mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0-0x80)), _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xF0-0x80))));
+        __m256i must23_80 = _mm256_and_si256(must23, _mm256_set1_epi8((char)0x80));
+
+        error = _mm256_or_si256(error, _mm256_xor_si256(must23_80, special));
+        incomplete = _mm256_subs_epu8(input, incomplete_max);
+        prev = input;
+    }
+
+    error = _mm256_or_si256(error, incomplete);
+    return _mm256_testz_si256(error, error) != 0;
+}
+#endif
+
+//whether all of [p, end) is valid UTF-8, with the widest validator the CPU has.
+static bool IsValidUTF8(const char * p, const char * end)
+{
+#if JSON_HAS_AVX2
+    if(HasAVX2())
+        return IsValidUTF8_AVX2(p, end);
+#endif
+#if JSON_HAS_SSSE3
+    if(HasSSSE3())
+        return IsValidUTF8_SSSE3(p, end);
+#endif
+
+    while(p < end)
+    {
+#if JSON_HAS_SSE2
+        for(; end - p >= 16; p += 16)
+        {
+            if(_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)p)))
+                break;
+        }
+
+        if(p == end)
+            break;
+#endif
+
+        bool valid;
+        p += DecodeUTF8(p, end, valid);
+
+        if(!valid)
+            return false;
+    }
+
+    return true;
+}
+
+void asSetDictionaryNormalization(StringNormalizeViewFunc UnicodeNormalization, StringNormalizeViewFunc PathNormalization, size_t cacheEntries, bool skipAscii)
+{
+    g_UnicodeViewFunc       = UnicodeNormalization;
+    g_PathViewFunc          = PathNormalization;
+    g_NormalizeCacheEntries = cacheEntries;
+    g_NormalizeSkipAscii    = skipAscii;
+
+    ++g_NormalizeGeneration;
+}
+
+//returns nullptr if the hook didn't change anything, otherwise the normalized text (in scratch or the cache).
+static std::string const* NormalizeUnicode(std::string const& in, std::string & scratch)
+{
+    struct CacheEntry
+    {
+        bool        changed;
+        std::string value;
+    };
+
+    struct Cache
+    {
+        unsigned generation{};
+        std::unordered_map<std::string, CacheEntry> entries;
+    };
+
+//long strings are unlikely to repeat and would only bloat the cache
+    static const size_t MaxCachedLength = 256;
+
+    if(g_UnicodeViewFunc == nullptr && g_UnicodeFunc == nullptr)
+        return nullptr;
+
+    if(g_NormalizeSkipAscii && IsAscii(in.data(), in.data() + in.size()))
+        return nullptr;
+
+    Cache * cache{};
+
+    if(g_NormalizeCacheEntries && in.size() <= MaxCachedLength)
+    {
+        static thread_local Cache t_cache;
+        cache = &t_cache;
+
+        if(cache->generation != g_NormalizeGeneration)
+        {
+            cache->entries.clear();
+            cache->generation = g_NormalizeGeneration;
+        }
+
+        auto itr = cache->entries.find(in);
+
+        if(itr != cache->entries.end())
+            return itr->second.changed? &itr->second.value : nullptr;
+    }
+
+    bool changed;
+
+    if(g_UnicodeViewFunc)
+        changed = g_UnicodeViewFunc(in.data(), in.size(), scratch);
+    else
+    {
+        scratch = g_UnicodeFunc(in);
+        changed = (scratch != in);
+    }
+
+    if(cache == nullptr)
+        return changed? &scratch : nullptr;
+
+    if(cache->entries.size() >= g_NormalizeCacheEntries)
+        cache->entries.clear();
+
+    auto & entry = cache->entries[in];
+    entry.changed = changed;
+
+    if(changed)
+        entry.value = scratch;
+
+    return changed? &entry.value : nullptr;
+}
+
+std::string const& NormalizePath(std::string const& path, std::string & scratch)
+{
+    if(g_PathViewFunc)
+        return g_PathViewFunc(path.data(), path.size(), scratch)? scratch : path;
+
+    if(g_PathFunc)
+        return scratch = g_PathFunc(path);
+
+    return path;
+}
+
+//writes straight into the stream, clean runs are copied in one go.
+static void WriteEscapedString(std::ostream & stream, const char * p, const char * end)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    while(p < end)
+    {
+        const char * run = p;
+        p = FindEscapeChar(p, end);
+        stream.write(run, p - run);
+
+        if(p == end)
+            break;
+
+        switch(*p)
+        {
+        case '"':  stream.write("\\\"", 2); break;
+        case '\\': stream.write("\\\\", 2); break;
+        case '\b': stream.write("\\b", 2); break;
+        case '\f': stream.write("\\f", 2); break;
+        case '\n': stream.write("\\n", 2); break;
+        case '\r': stream.write("\\r", 2); break;
+        case '\t': stream.write("\\t", 2); break;
+        default:
+        {
+            char buffer[6] = {'\\', 'u', '0', '0', hex[(*p >> 4) & 0x0F], hex[*p & 0x0F]};
+            stream.write(buffer, sizeof(buffer));
+        } break;
+        }
+
+        ++p;
+    }
+}
+
+static void WriteEscapedString(std::ostream & stream, std::string const& in)
+{
+    std::string scratch;
+    std::string const* normalized = NormalizeUnicode(in, scratch);
+    std::string const& s = normalized? *normalized : in;
+
+    WriteEscapedString(stream, s.data(), s.data() + s.size());
+}
+
+struct JSONTokenRange;
+
+    union JSON_ANY
+    {
+        bool   boolean;
+        asINT64 _int{};
+        double  dbl;
+        void  * obj;
+    };
+
+//one node per key/value in document order. Built from the text without the engine, so it can happen on any thread.
+struct JSONNode
+{
+    enum Type : uint8_t { Object, Array, String, Int, Double, Bool, Null };
+
+    explicit JSONNode(Type type) : type(type), boolean(), length(), next(), _int() {}
+
+    Type     type;
+    bool     boolean;
+//members of an Object/Array, bytes of a String
+    uint32_t length;
+//index of the node following this one's children
+    uint32_t next;
+
+    union
+    {
+        asINT64      _int;
+        double       dbl;
+        const char * str;
+    };
+};
+
+//nodes live in fixed-size chunks, so growing the tape never copies it or leaves an old copy behind in the arena.
+class JSONTape
+{
+public:
+    static const uint32_t ChunkShift = 8;
+    static const uint32_t ChunkSize  = 1u << ChunkShift;
+
+    explicit JSONTape(JSONArena & arena) : chunks(arena) {}
+
+    size_t size() const { return count; }
+    JSONArena & arena() const { return *chunks.get_allocator().arena; }
+
+    JSONNode       & operator[](size_t i)       { return chunks[i >> ChunkShift][i & (ChunkSize-1)]; }
+    JSONNode const & operator[](size_t i) const { return chunks[i >> ChunkShift][i & (ChunkSize-1)]; }
+
+    void push_back(JSONNode const& node)
+    {
+        if((count & (ChunkSize-1)) == 0)
+            chunks.push_back((JSONNode*)arena().Allocate(ChunkSize * sizeof(JSONNode), alignof(JSONNode)));
+
+        new(&(*this)[count]) JSONNode(node);
+        ++count;
+    }
+
+private:
+    JSONVector<JSONNode*> chunks;
+    size_t                count{};
+};
+struct JSONTapeRange;
+
+static void TokenizeDocument(char * data, size_t size, JSONTape & tape, JSONParseLimits const& limits);
+static void asFromJSON_String(JSONTapeRange & stream, JSON_ANY & value, int & typeId);
+template<typename String>
+static const char * CleanString(const char *, const char * end, String & out, JSONUTF8Mode utf8);
+static void FreePairVec(asIScriptEngine * engine, JSONVector<std::pair<JSON_ANY, int> > & vec);
+
+struct JSONTokenRange
+{
+    static bool ischar(char c, const char * str)
+    {
+        for(;*str; ++str)
+        {
+            if(c == *str) return true;
+        }
+
+        return false;
+    }
+
+//data must be writable and have a 0 at data[size].
+    JSONTokenRange(char * data, size_t size) :
+        begin(data),
+        end(data + size),
+        tokBegin(data),
+        tokEnd(data),
+        swapChar(tokBegin? *tokBegin : 0)
+    {
+        popFront();
+    }
+
+    bool empty() const { return tokBegin >= end || *tokBegin == 0; }
+    const char * front() const { return tokBegin; }
+    const char * back() const { return tokEnd; }
+    size_t offset() const { return tokBegin - begin; }
+//strings are unescaped in place, the result is never longer than the token.
+    char * writable() const { return tokBegin; }
+//false if the current string token may contain bytes >= 0x80.
+    bool ascii() const { return tokAscii; }
+
+    void popFront()
+    {
+        if(empty()) return;
+
+        *tokEnd = swapChar;
+
+//skip whitespace
+        for(tokBegin = tokEnd; tokBegin < end && *tokBegin && *tokBegin <= ' '; ++tokBegin) { }
+
+        if(tokBegin < end && ischar(*tokBegin, ",:[]{}"))
+            tokEnd = tokBegin+1;
+        else if(tokBegin < end && ischar(*tokBegin, "'\"`"))
+        {
+            tokAscii = true;
+
+            for(tokEnd = tokBegin+1; tokEnd < end && *tokEnd; )
+            {
+                tokEnd = const_cast<char*>(FindQuoteOrEscape(tokEnd, end, *tokBegin, tokAscii));
+
+                if(tokEnd == end || *tokEnd == 0)
+                    break;
+
+                if(*tokEnd == '\\')
+                {
+                    if(tokEnd+1 < end && (unsigned char)tokEnd[1] >= 0x80)
+                        tokAscii = false;
+
+                    tokEnd = std::min(tokEnd+2, const_cast<char*>(end));
+                    continue;
+                }
+
+                ++tokEnd;
+                break;
+            }
+        }
+        else
+        {
+    //move to end of token
+            for(tokEnd = tokBegin+1; tokEnd < end && *tokEnd; ++tokEnd)
+            {
+                if(*tokEnd <= ' '
+                || ischar(*tokEnd, ",:[]{}") )
+                    break;
+            }
+        }
+
+        if(tokEnd < end)
+        {
+            swapChar = *tokEnd;
+            *tokEnd = 0;
+        }
+    }
+
+private:
+    const char *const begin{};
+    const char *const end{};
+    char * tokBegin{};
+    char * tokEnd{};
+
+    char swapChar{};
+    bool tokAscii{};
+};
+
+//walks a tape in document order while the script objects are created.
+struct JSONTapeRange
+{
+    JSONTapeRange(JSONTape const& tape, asIScriptEngine * engine, JSONArena & arena) :
+        engine(engine),
+        asTypeIdDictionary(engine->GetTypeIdByDecl("dictionary")),
+        asTypeIdString(engine->GetTypeIdByDecl("string")),
+        arena(arena),
+        tape(tape)
+    {
+    }
+
+    bool empty() const { return index >= tape.size(); }
+    JSONNode const& front() const { return tape[index]; }
+    void popFront() { ++index; }
+//past front() and everything inside it.
+    void skip() { index = tape[index].next; }
+
+    asIScriptEngine * const engine{};
+    const int asTypeIdDictionary;
+    const int asTypeIdString;
+    JSONArena & arena;
+//script strings have to be built from a std::string, reusing one keeps that to a single allocation per parse.
+    std::string scratch;
+
+private:
+    JSONTape const& tape;
+    uint32_t index{};
+};
+
+CScriptDictionary * asFromJSON_String(std::string const& stream,  asIScriptEngine * engine)
+{
+    return asFromJSON_String(stream, engine, g_ParseLimits);
+}
+
+CScriptDictionary * asFromJSON_String(std::string const& stream,  asIScriptEngine * engine, JSONParseLimits const& limits)
+{
+    JSONScratchScope scratch;
+    char * contents = CopyDocument(stream, scratch.arena, limits);
+
+    return asFromJSON_Buffer(contents, stream.size(), engine, limits);
+}
+
+static bool StartsWithObject(const char * data, size_t size)
+{
+    const char * end = data + size;
+
+    for(; data < end && *data && *data <= ' '; ++data) { }
+
+    return data < end && *data == '{';
+}
+
+//builds the dictionary for a tape whose first node is an Object.
+static CScriptDictionary * BuildDocument(JSONTape const& tape, asIScriptEngine * engine, JSONArena & arena)
+{
+    JSONTapeRange stream(tape, engine, arena);
+    JSON_ANY value{};
+    int typeId{};
+
+    asFromJSON_String(stream, value, typeId);
+    assert(typeId == stream.asTypeIdDictionary);
+
+    return (CScriptDictionary*)value.obj;
+}
+
+CScriptDictionary * asFromJSON_Buffer(char * data, size_t size, asIScriptEngine * engine, JSONParseLimits const& limits)
+{
+    if(!StartsWithObject(data, size))
+        return nullptr;
+
+    JSONScratchScope scratch;
+
+    try
+    {
+        JSONTape tape(scratch.arena);
+        TokenizeDocument(data, size, tape, limits);
+
+        return BuildDocument(tape, engine, scratch.arena);
+    }
+    catch(std::exception & e)
+    {
+		auto ctx = asGetActiveContext();
+		
+		if(ctx)
+			ctx->SetException(e.what());
+		else
+			throw;
+
+		return nullptr;
+    }
+}
+
+//writes into the token's own storage, until a U+FFFD goes in: that can be longer than what it replaces, so the string moves to the arena first.
+struct JSONInPlaceString
+{
+    void clear() { end = begin; }
+    void push_back(char c) { *end++ = c; }
+    void append(const char * p, size_t n) { memmove(end, p, n); end += n; }
+
+    void push_replacement()
+    {
+        if(!moved)
+        {
+//nothing in a token comes out longer than 3 times its size.
+            char * to = (char*)arena->Allocate((limit - begin) * 3, 1);
+            memcpy(to, begin, end - begin);
+            end   = to + (end - begin);
+            begin = to;
+            moved = true;
+        }
+
+        append("\xEF\xBF\xBD", 3);
+    }
+
+    char * begin;
+    char * end;
+    const char * limit;
+    JSONArena * arena;
+    bool moved{};
+};
+
+static void TokenizeString(JSONTokenRange & stream, JSONTape & tape, JSONUTF8Mode utf8)
+{
+    JSONInPlaceString out{stream.writable()+1, stream.writable()+1, stream.back(), &tape.arena()};
+    const char * bad = CleanString(stream.front(), stream.back(), out, stream.ascii()? JSONUTF8Mode::Accept : utf8);
+
+    if(bad != nullptr)
+        throw std::runtime_error("invalid UTF-8 at byte " + std::to_string(stream.offset() + (bad - stream.front())));
+
+    JSONNode node{JSONNode::String};
+    node.length = (uint32_t)(out.end - out.begin);
+    node.next   = (uint32_t)tape.size()+1;
+    node.str    = out.begin;
+    tape.push_back(node);
+}
+
+static std::runtime_error ParseError(JSONTokenRange const& stream, std::string what)
+{
+    if(stream.empty())
+        what += " found EOF";
+    else
+    {
+        size_t length = strlen(stream.front());
+        what += " found \"";
+        what.append(stream.front(), std::min<size_t>(length, 32));
+        what += length > 32? "...\"" : "\"";
+    }
+
+    what += " at byte ";
+    what += std::to_string(stream.offset());
+    return std::runtime_error(what);
+}
+
+//true, false, null, numbers and strings.
+static void TokenizeScalar(JSONTokenRange & stream, JSONTape & tape, JSONUTF8Mode utf8)
+{
+    JSONNode node{JSONNode::Bool};
+    node.next = (uint32_t)tape.size()+1;
+
+    if(strcmp(stream.front(), "null") == 0)
+    {
+        node.type = JSONNode::Null;
+        tape.push_back(node);
+        return;
+    }
+
+    if(strcmp(stream.front(), "true") == 0)
+    {
+        node.boolean = true;
+        tape.push_back(node);
+        return;
+    }
+    if(strcmp(stream.front(), "false") == 0)
+    {
+        node.boolean = false;
+        tape.push_back(node);
+        return;
+    }
+
+    if(('0' <= *stream.front() && *stream.front() <= '9') || JSONTokenRange::ischar(*stream.front(), ".-+eE"))
+    {
+        auto p = stream.front();
+
+        bool is_float = false;
+        for(; *p != 0; ++p)
+        {
+            if(*p == '.' || tolower(*p) == 'e')
+            {
+                is_float = true;
+            }
+        }
+
+        if(!is_float)
+        {
+            node.type = JSONNode::Int;
+            node._int = strtoll(stream.front(), nullptr, 10);
+        }
+        else
+        {
+            node.type = JSONNode::Double;
+            node.dbl  = strtod(stream.front(), nullptr);
+        }
+
+        tape.push_back(node);
+        return;
+    }
+
+    if(JSONTokenRange::ischar(*stream.front(), "'\"`"))
+    {
+        TokenizeString(stream, tape, utf8);
+        return;
+    }
+
+    throw ParseError(stream, "unexpected token");
+}
+
+//syntax only, the first value in data ends up on the tape. Strings on the tape point into data.
+//containers are tracked on a heap stack rather than the native one, so nesting is only bounded by limits.maxDepth.
+void TokenizeDocument(char * data, size_t size, JSONTape & tape, JSONParseLimits const& limits)
+{
+    CheckLimits(limits);
+    CheckDocumentSize(size, limits);
+
+    JSONTokenRange stream(data, size);
+
+    if(stream.empty())
+        throw ParseError(stream, "expected value");
+
+//tape index of each open object/array
+    JSONVector<uint32_t> stack(tape.arena());
+    size_t elements = 0;
+
+    for(;;)
+    {
+//stream.front() is the start of a value.
+        if(limits.maxElements && ++elements > limits.maxElements)
+            throw ParseError(stream, "more than " + std::to_string(limits.maxElements) + " elements");
+
+        bool opened = false;
+
+        if(*stream.front() == '{' || *stream.front() == '[')
+        {
+            if(stack.size() >= limits.maxDepth)
+                throw ParseError(stream, "nested deeper than " + std::to_string(limits.maxDepth));
+
+            stack.push_back((uint32_t)tape.size());
+            tape.push_back(JSONNode(*stream.front() == '{'? JSONNode::Object : JSONNode::Array));
+            opened = true;
+        }
+        else
+            TokenizeScalar(stream, tape, limits.utf8);
+
+//move on to the next value, closing containers as we go.
+        for(;;)
+        {
+            if(stack.empty())
+                return;
+
+            JSONNode & top = tape[stack.back()];
+            bool is_object = top.type == JSONNode::Object;
+            char close     = is_object? '}' : ']';
+
+            if(!opened)
+            {
+                ++top.length;
+                stream.popFront();
+
+                if(stream.empty() || (*stream.front() != ',' && *stream.front() != close))
+                    throw ParseError(stream, is_object? "expected ',' or '}'" : "expected ',' or ']'");
+
+                if(*stream.front() == close)
+                {
+                    top.next = (uint32_t)tape.size();
+                    stack.pop_back();
+                    continue;
+                }
+            }
+
+            opened = false;
+            stream.popFront();
+
+            if(stream.empty())
+                throw ParseError(stream, is_object? "expected string" : "expected item");
+
+//not strictly correct (allows trailing commas) but i don't really care.
+            if(*stream.front() == close)
+            {
+                top.next = (uint32_t)tape.size();
+                stack.pop_back();
+                continue;
+            }
+
+            if(is_object)
+            {
+                if(JSONTokenRange::ischar(*stream.front(), "'`\"") == false)
+                    throw ParseError(stream, "expected string");
+
+                TokenizeString(stream, tape, limits.utf8);
+
+                stream.popFront();
+
+                if(stream.empty() || *stream.front() != ':')
+                    throw ParseError(stream, "expected ':'");
+
+                stream.popFront();
+
+                if(stream.empty())
+                    throw ParseError(stream, "expected value");
+            }
+
+            break;
+        }
+    }
+}
+
+static CScriptArray * asFromJSON_String(JSONTapeRange & stream, JSONVector<std::pair<JSON_ANY, int> > & items, size_t base)
+{
+    if(items.size() == base)
+    {
+//nothing to go on for the type, so empty arrays are all array<dictionary@>.
+        return CScriptArray::Create(stream.engine->GetTypeInfoByDecl("array<dictionary@>"));
+    }
+
+    auto vec = items.begin() + base;
+    size_t count = items.size() - base;
+
+    int const null_type = stream.asTypeIdDictionary | asTYPEID_OBJHANDLE;
+    int cur_type = vec[0].second;
+    bool has_null = false;
+
+    for(asUINT i = 0; i < count; ++i)
+    {
+//nulls go along with whatever other objects the array holds.
+        if(vec[i].first.obj == nullptr && vec[i].second == null_type)
+        {
+            has_null = true;
+            continue;
+        }
+
+        if(cur_type == null_type && (vec[i].second & asTYPEID_MASK_OBJECT))
+            cur_type = vec[i].second;
+
+        if(cur_type != vec[i].second)
+        {
+            if(cur_type == asTYPEID_DOUBLE && vec[i].second == asTYPEID_INT64)
+            {
+                vec[i].first.dbl = vec[i].first._int;
+                vec[i].second = asTYPEID_DOUBLE;
+                continue;
+            }
+
+            if(cur_type == asTYPEID_INT64 && vec[i].second == asTYPEID_DOUBLE)
+            {
+                cur_type = asTYPEID_DOUBLE;
+                i = -1;
+                continue;
+            }
+
+            throw std::runtime_error("type mismatch: all entries in array must have same asTYPEID.");
+        }
+    }
+
+    if(has_null && !(cur_type & asTYPEID_MASK_OBJECT))
+        throw std::runtime_error("type mismatch: null in an array of " + std::string(GetFullTypeName(stream.engine, cur_type, stream.arena).c_str()));
+
+    JSONString type_name(stream.arena);
+    type_name += "array<";
+    type_name += GetFullTypeName(stream.engine, cur_type, stream.arena);
+    type_name += ">";
+
+    auto typeInfo = stream.engine->GetTypeInfoByDecl(type_name.c_str());
+    assert(typeInfo && (typeInfo->GetSubTypeId() == cur_type || typeInfo->GetSubTypeId() == (cur_type | asTYPEID_OBJHANDLE)));
+
+    CScriptArray * array = CScriptArray::Create(typeInfo, count);
+
+    auto subType = array->GetArrayObjectType()->GetSubType();
+    bool is_value = subType? subType->GetFlags() & asOBJ_VALUE : false;
+
+    if(has_null && is_value)
+    {
+        array->Release();
+        throw std::runtime_error("type mismatch: null in " + std::string(type_name.c_str()));
+    }
+
+    for(asUINT i = 0; i < count; ++i)
+    {
+        if(vec[i].first.obj == nullptr && vec[i].second == null_type)
+            continue;
+
+        array->SetValue(i, is_value? vec[i].first.obj : &vec[i].first);
+
+        if(vec[i].second & asTYPEID_MASK_OBJECT)
+            stream.engine->ReleaseScriptObject(vec[i].first.obj, subType);
+    }
+
+    items.erase(vec, items.end());
+    return array;
+}
+
+const char * GetPrimitiveTypeName(int typeId)
+{
+    switch(typeId)
+    {
+    case asTYPEID_VOID: return "void";
+    case asTYPEID_BOOL: return "bool";
+    case asTYPEID_INT8: return "int8";
+    case asTYPEID_INT16: return "int16";
+    case asTYPEID_INT32: return "int";
+    case asTYPEID_INT64: return "int64";
+    case asTYPEID_UINT8: return "uint8";
+    case asTYPEID_UINT16: return "uint16";
+    case asTYPEID_UINT32: return "uint";
+    case asTYPEID_UINT64: return "uint64";
+    case asTYPEID_FLOAT: return "float";
+    case asTYPEID_DOUBLE: return "double";
+    default:
+        break;
+    }
+
+    return "";
+}
+
+JSONString GetFullTypeName(asIScriptEngine * engine, int typeId, JSONArena & arena)
+{
+    JSONString name(arena);
+
+    auto op = GetPrimitiveTypeName(typeId);
+    if(*op) return name.assign(op);
+
+    auto typeInfo = engine->GetTypeInfoById(typeId);
+
+    if(!typeInfo)
+    {
+        return name.assign("void");
+    }
+
+    name = typeInfo->GetName();
+
+    if(typeInfo->GetFlags() & asOBJ_TEMPLATE)
+    {
+        name += "<";
+
+        for(asUINT i = 0; i < typeInfo->GetSubTypeCount(); ++i)
+        {
+            name += GetFullTypeName(engine, typeInfo->GetSubTypeId(i), arena);
+
+            if(i+1 < typeInfo->GetSubTypeCount())
+            {
+                name += ", ";
+            }
+        }
+
+        name += ">";
+    }
+
+    if(!(typeInfo->GetFlags() & asOBJ_VALUE))
+        name += "@";
+
+    return name;
+}
+
+void FreePairVec(asIScriptEngine * engine, JSONVector<std::pair<JSON_ANY, int> > & vec)
+{
+    for(asUINT i = 0; i < vec.size(); ++i)
+    {
+        if((vec[i].second & asTYPEID_MASK_OBJECT) && vec[i].first.obj)
+            engine->ReleaseScriptObject(vec[i].first.obj, engine->GetTypeInfoById(vec[i].second));
+    }
+
+    vec.clear();
+}
+
+static int ParseHex4(const char * p, const char * end)
+{
+    if(end - p < 4)
+        return -1;
+
+    int r = 0;
+
+    for(int i = 0; i < 4; ++i)
+    {
+        char c = p[i];
+        r <<= 4;
+
+        if('0' <= c && c <= '9')      r |= c - '0';
+        else if('a' <= c && c <= 'f') r |= c - 'a' + 10;
+        else if('A' <= c && c <= 'F') r |= c - 'A' + 10;
+        else return -1;
+    }
+
+    return r;
+}
+
+template<typename String>
+static void AppendUTF8(String & r, uint32_t cp)
+{
+    char buffer[4];
+
+    if(cp < 0x80)
+    {
+        r.push_back((char)cp);
+        return;
+    }
+
+    if(cp < 0x800)
+    {
+        buffer[0] = (char)(0xC0 | (cp >> 6));
+        buffer[1] = (char)(0x80 | (cp & 0x3F));
+        r.append(buffer, 2);
+    }
+    else if(cp < 0x10000)
+    {
+        buffer[0] = (char)(0xE0 | (cp >> 12));
+        buffer[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        buffer[2] = (char)(0x80 | (cp & 0x3F));
+        r.append(buffer, 3);
+    }
+    else
+    {
+        buffer[0] = (char)(0xF0 | (cp >> 18));
+        buffer[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        buffer[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        buffer[3] = (char)(0x80 | (cp & 0x3F));
+        r.append(buffer, 4);
+    }
+}
+
+//a run that fails the check is copied a sequence at a time, invalid ones are rejected, replaced or dropped.
+template<typename String>
+static const char * AppendRun(String & r, const char * p, const char * end, JSONUTF8Mode utf8)
+{
+    if(utf8 == JSONUTF8Mode::Accept || IsValidUTF8(p, end))
+    {
+        r.append(p, end - p);
+        return nullptr;
+    }
+
+    while(p < end)
+    {
+        bool valid;
+        int length = DecodeUTF8(p, end, valid);
+
+        if(valid)
+            r.append(p, length);
+        else if(utf8 == JSONUTF8Mode::Reject)
+            return p;
+        else if(utf8 == JSONUTF8Mode::Replace)
+            r.push_replacement();
+
+        p += length;
+    }
+
+    return nullptr;
+}
+
+//input/end is the whole token including quotes, everything between backslashes is appended in one go.
+//escapes are 7 bit, so each run can be checked on its own; returns the first invalid byte if utf8 is Reject.
+template<typename String>
+const char * CleanString(const char * input, const char * end, String & r, JSONUTF8Mode utf8)
+{
+    r.clear();
+
+    const char * p = input+1;
+    end = end-1;
+
+    while(p < end)
+    {
+        const char * run = p;
+        p = (const char*)memchr(p, '\\', end - p);
+
+        if(p == nullptr)
+            return AppendRun(r, run, end, utf8);
+
+        if(const char * bad = AppendRun(r, run, p, utf8))
+            return bad;
+
+        if(++p == end)
+        {
+            r.push_back('\\');
+            break;
+        }
+
+        switch(*p++)
+        {
+        case 'b': r.push_back('\b'); break;
+        case 'f': r.push_back('\f'); break;
+        case 'n': r.push_back('\n'); break;
+        case 'r': r.push_back('\r'); break;
+        case 't': r.push_back('\t'); break;
+        case 'u':
+        {
+            int cp = ParseHex4(p, end);
+
+            if(cp < 0)
+            {
+                r.append("\\u", 2);
+                break;
+            }
+
+            p += 4;
+
+            if(0xD800 <= cp && cp < 0xDC00)
+            {
+                int lo = (end - p >= 6 && p[0] == '\\' && p[1] == 'u')? ParseHex4(p+2, end) : -1;
+
+                if(0xDC00 <= lo && lo < 0xE000)
+                {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                    p += 6;
+                }
+                else
+                    cp = 0xFFFD;
+            }
+            else if(0xDC00 <= cp && cp < 0xE000)
+                cp = 0xFFFD;
+
+            AppendUTF8(r, cp);
+        } break;
+//quotes, '\\', '/' and anything we don't know just lose the backslash, a lead byte starts the next run so it's checked with its sequence.
+        default:
+            if((unsigned char)p[-1] >= 0x80)
+                --p;
+            else
+                r.push_back(p[-1]);
+            break;
+        }
+    }
+
+    return nullptr;
+}
+
+static void ReadScalar(JSONTapeRange & stream, JSON_ANY & value, int & typeId)
+{
+    JSONNode const& node = stream.front();
+
+    switch(node.type)
+    {
+    case JSONNode::Bool:
+        value.boolean = node.boolean;
+        typeId        = asTYPEID_BOOL;
+        break;
+    case JSONNode::Int:
+        value._int = node._int;
+        typeId     = asTYPEID_INT64;
+        break;
+    case JSONNode::Double:
+        value.dbl = node.dbl;
+        typeId    = asTYPEID_DOUBLE;
+        break;
+//there's no type to go on, so a null is a dictionary@ that isn't set.
+    case JSONNode::Null:
+        value.obj = nullptr;
+        typeId    = stream.asTypeIdDictionary | asTYPEID_OBJHANDLE;
+        break;
+    case JSONNode::String:
+    {
+        stream.scratch.assign(node.str, node.length);
+		auto typeInfo = stream.engine->GetTypeInfoById(stream.engine->GetStringFactory(nullptr, nullptr));
+
+        value.obj  = stream.engine->CreateScriptObjectCopy(&stream.scratch, typeInfo);
+        typeId     = stream.asTypeIdString;
+        break;
+    }
+    default:
+        assert(false);
+        break;
+    }
+
+    stream.popFront();
+}
+
+//builds the value at stream.front(), mirrors TokenizeDocument so nesting doesn't use the native stack either.
+static void asFromJSON_String(JSONTapeRange & stream, JSON_ANY & value, int & typeId)
+{
+    JSONNode::Type type = stream.front().type;
+
+    if(type != JSONNode::Object && type != JSONNode::Array)
+    {
+        ReadScalar(stream, value, typeId);
+        return;
+    }
+
+    struct Frame
+    {
+//null for arrays, their items collect at the end of items until they close.
+        CScriptDictionary * dict;
+        JSONNode const    * key;
+        uint32_t            remaining;
+        size_t              base;
+    };
+
+    JSONVector<Frame> stack(stream.arena);
+    JSONVector<std::pair<JSON_ANY, int> > items(stream.arena);
+    JSONNode const* key{};
+
+    try
+    {
+        for(;;)
+        {
+            JSONNode const& node = stream.front();
+            bool finished = false;
+
+            if(node.type == JSONNode::Object || node.type == JSONNode::Array)
+            {
+                stack.push_back({nullptr, key, node.length, items.size()});
+
+                if(node.type == JSONNode::Object)
+                    stack.back().dict = CScriptDictionary::Create(stream.engine);
+                else
+                    items.reserve(items.size() + node.length);
+
+                stream.popFront();
+            }
+            else
+            {
+                ReadScalar(stream, value, typeId);
+                finished = true;
+            }
+
+            for(;;)
+            {
+                if(finished)
+                {
+                    Frame & parent = stack.back();
+                    --parent.remaining;
+                    finished = false;
+
+                    if(parent.dict == nullptr)
+                        items.push_back({value, typeId});
+                    else
+                    {
+                        stream.scratch.assign(key->str, key->length);
+
+                        if(typeId == asTYPEID_INT64)
+                        {
+                            parent.dict->Set(stream.scratch, value._int);
+                        }
+                        else if(typeId == asTYPEID_DOUBLE)
+                        {
+                            parent.dict->Set(stream.scratch, value.dbl);
+                        }
+                        else if(typeId == asTYPEID_BOOL)
+                        {
+                            parent.dict->Set(stream.scratch, &value.boolean, typeId);
+                        }
+                        else if(value.obj == nullptr)
+                        {
+                            parent.dict->Set(stream.scratch, &value.obj, typeId);
+                        }
+                        else
+                        {
+                            parent.dict->Set(stream.scratch, value.obj, typeId);
+                            stream.engine->ReleaseScriptObject(value.obj, stream.engine->GetTypeInfoById(typeId));
+                        }
+                    }
+                }
+
+                Frame & top = stack.back();
+
+                if(top.remaining != 0)
+                {
+                    key = nullptr;
+
+                    if(top.dict)
+                    {
+                        key = &stream.front();
+                        stream.popFront();
+                    }
+
+                    break;
+                }
+
+                if(top.dict)
+                {
+                    value.obj = top.dict;
+                    typeId    = stream.asTypeIdDictionary;
+                }
+                else
+                {
+                    CScriptArray * array = asFromJSON_String(stream, items, top.base);
+                    value.obj = array;
+                    typeId    = array->GetArrayTypeId();
+                }
+
+                key = top.key;
+                stack.pop_back();
+
+                if(stack.empty())
+                    return;
+
+                finished = true;
+            }
+        }
+    }
+    catch(std::exception &)
+    {
+        for(auto & frame : stack)
+        {
+            if(frame.dict)
+                frame.dict->Release();
+        }
+
+        FreePairVec(stream.engine, items);
+        throw;
+    }
+}
+
+/* RFC 6902 JSON Patch */
+
+struct JSONTypeIds
+{
+    JSONTypeIds(asIScriptEngine * engine) :
+        engine(engine),
+        asTypeIdDictionary(engine->GetTypeIdByDecl("dictionary")),
+        asTypeIdString(engine->GetStringFactory(nullptr, nullptr))
+    {
+    }
+
+    static int Strip(int typeId) { return typeId & ~(asTYPEID_OBJHANDLE | asTYPEID_HANDLETOCONST); }
+
+    bool IsDictionary(int typeId) const { return Strip(typeId) == asTypeIdDictionary; }
+    bool IsString(int typeId) const { return Strip(typeId) == asTypeIdString; }
+    bool IsArray(int typeId) const
+    {
+        if(!(typeId & asTYPEID_MASK_OBJECT))
+            return false;
+
+        auto typeInfo = engine->GetTypeInfoById(typeId);
+        return typeInfo && strcmp(typeInfo->GetName(), "array") == 0;
+    }
+
+    asIScriptEngine * const engine;
+    const int asTypeIdDictionary;
+    const int asTypeIdString;
+};
+
+//addresses are what dictionaries/arrays hand out: the object itself, or a pointer to the handle.
+static void * Deref(int typeId, void const* address)
+{
+    if(address && (typeId & asTYPEID_OBJHANDLE))
+        return *(void**)address;
+
+    return const_cast<void*>(address);
+}
+
+static bool ReadNumber(int typeId, void const* p, asINT64 & i, double & d, bool & isFloat)
+{
+    isFloat = false;
+
+    switch(typeId)
+    {
+    case asTYPEID_INT8:   i = *(const int8_t*)p; break;
+    case asTYPEID_INT16:  i = *(const int16_t*)p; break;
+    case asTYPEID_INT32:  i = *(const int32_t*)p; break;
+    case asTYPEID_INT64:  i = *(const int64_t*)p; break;
+    case asTYPEID_UINT8:  i = *(const uint8_t*)p; break;
+    case asTYPEID_UINT16: i = *(const uint16_t*)p; break;
+    case asTYPEID_UINT32: i = *(const uint32_t*)p; break;
+    case asTYPEID_UINT64: i = (asINT64)*(const uint64_t*)p; break;
+    case asTYPEID_FLOAT:  d = *(const float*)p; isFloat = true; return true;
+    case asTYPEID_DOUBLE: d = *(const double*)p; isFloat = true; return true;
+    case asTYPEID_VOID:
+    case asTYPEID_BOOL:
+        return false;
+    default:
+//enums
+        if((typeId & asTYPEID_MASK_SEQNBR) != typeId)
+            return false;
+
+        i = *(const int32_t*)p;
+        break;
+    }
+
+    d = (double)i;
+    return true;
+}
+
+//false if the value doesn't fit in T, converting it anyway would be undefined.
+template<typename T>
+static bool StoreNumber(JSONNode const& node, void * address)
+{
+    typedef std::numeric_limits<T> limits;
+
+    if(!limits::is_integer)
+    {
+        if(node.type == JSONNode::Double && std::isfinite(node.dbl) && std::fabs(node.dbl) > (double)limits::max())
+            return false;
+
+        *(T*)address = node.type == JSONNode::Int? (T)node._int : (T)node.dbl;
+        return true;
+    }
+
+    if(node.type == JSONNode::Int)
+    {
+        if(limits::is_signed? (node._int < (asINT64)limits::min() || node._int > (asINT64)limits::max())
+                            : (node._int < 0 || (uint64_t)node._int > (uint64_t)limits::max()))
+            return false;
+
+        *(T*)address = (T)node._int;
+        return true;
+    }
+
+//the fraction is dropped, so compare what's left against [min, max+1); NaN fails both.
+    double whole = std::trunc(node.dbl);
+    double upper = std::ldexp(1.0, limits::digits);
+
+    if(!(whole >= (limits::is_signed? -upper : 0.0) && whole < upper))
+        return false;
+
+    *(T*)address = (T)whole;
+    return true;
+}
+
+//false if the number doesn't fit in typeId.
+static bool WriteNumber(int typeId, void * p, asINT64 i, double d, bool isFloat)
+{
+    JSONNode node{isFloat? JSONNode::Double : JSONNode::Int};
+
+    if(isFloat) node.dbl  = d;
+    else        node._int = i;
+
+    switch(typeId)
+    {
+    case asTYPEID_INT8:   return StoreNumber<int8_t>(node, p);
+    case asTYPEID_INT16:  return StoreNumber<int16_t>(node, p);
+    case asTYPEID_INT64:  return StoreNumber<int64_t>(node, p);
+    case asTYPEID_UINT8:  return StoreNumber<uint8_t>(node, p);
+    case asTYPEID_UINT16: return StoreNumber<uint16_t>(node, p);
+    case asTYPEID_UINT32: return StoreNumber<uint32_t>(node, p);
+    case asTYPEID_UINT64: return StoreNumber<uint64_t>(node, p);
+    case asTYPEID_FLOAT:  return StoreNumber<float>(node, p);
+    case asTYPEID_DOUBLE: return StoreNumber<double>(node, p);
+//int32 and enums
+    default:              return StoreNumber<int32_t>(node, p);
+    }
+}
+
+//depth is how many containers deep a and b already are.
+static bool ValuesEqual(JSONTypeIds const& ids, int typeA, void const* a, int typeB, void const* b, size_t depth = 0);
+
+static bool DictionariesEqual(JSONTypeIds const& ids, CScriptDictionary const* a, CScriptDictionary const* b, size_t depth)
+{
+    if(a == b)
+        return true;
+
+    CheckDepth(depth+1);
+
+    if(a->GetSize() != b->GetSize())
+        return false;
+
+    for(auto & i : *a)
+    {
+        auto j = b->find(i.GetKey());
+
+        if(j == b->end() || !ValuesEqual(ids, i.GetTypeId(), i.GetAddressOfValue(), j.GetTypeId(), j.GetAddressOfValue(), depth+1))
+            return false;
+    }
+
+    return true;
+}
+
+static bool ArraysEqual(JSONTypeIds const& ids, CScriptArray const* a, CScriptArray const* b, size_t depth)
+{
+    if(a == b)
+        return true;
+
+    CheckDepth(depth+1);
+
+    if(a->GetSize() != b->GetSize())
+        return false;
+
+    for(asUINT i = 0; i < a->GetSize(); ++i)
+    {
+        if(!ValuesEqual(ids, a->GetElementTypeId(), a->At(i), b->GetElementTypeId(), b->At(i), depth+1))
+            return false;
+    }
+
+    return true;
+}
+
+//compares by JSON meaning: int64 1 == double 1.0 == uint8 1, but true != 1.
+bool ValuesEqual(JSONTypeIds const& ids, int typeA, void const* a, int typeB, void const* b, size_t depth)
+{
+    a = Deref(typeA, a);
+    b = Deref(typeB, b);
+
+    if(a == nullptr || b == nullptr)
+        return a == b;
+
+    if(typeA == asTYPEID_BOOL || typeB == asTYPEID_BOOL)
+        return typeA == typeB && *(const bool*)a == *(const bool*)b;
+
+    asINT64 intA{}, intB{};
+    double  dblA{}, dblB{};
+    bool    fltA{}, fltB{};
+
+    if(ReadNumber(typeA, a, intA, dblA, fltA))
+    {
+        if(!ReadNumber(typeB, b, intB, dblB, fltB))
+            return false;
+
+        return (fltA || fltB)? dblA == dblB : intA == intB;
+    }
+
+    if(ids.IsString(typeA))
+        return ids.IsString(typeB) && *(const std::string*)a == *(const std::string*)b;
+
+    if(ids.IsDictionary(typeA))
+        return ids.IsDictionary(typeB) && DictionariesEqual(ids, (CScriptDictionary const*)a, (CScriptDictionary const*)b, depth);
+
+    if(ids.IsArray(typeA))
+        return ids.IsArray(typeB) && ArraysEqual(ids, (CScriptArray const*)a, (CScriptArray const*)b, depth);
+
+    return a == b;
+}
+
+static CScriptDictionary * DeepCopy(JSONTypeIds const& ids, CScriptDictionary const* dict, size_t depth = 0);
+static CScriptArray * DeepCopy(JSONTypeIds const& ids, CScriptArray const* array, size_t depth = 0);
+
+//new reference to a copy of a dictionary/array, or nullptr if the value isn't a container.
+static void * DeepCopyContainer(JSONTypeIds const& ids, int typeId, void const* address, size_t depth = 0)
+{
+    void * object = Deref(typeId, address);
+
+    if(object == nullptr)
+        return nullptr;
+
+    if(ids.IsDictionary(typeId))
+        return DeepCopy(ids, (CScriptDictionary const*)object, depth);
+
+    if(ids.IsArray(typeId))
+        return DeepCopy(ids, (CScriptArray const*)object, depth);
+
+    return nullptr;
+}
+
+static void SetDictValue(CScriptDictionary * dict, std::string const& key, int typeId, void * address)
+{
+    if(typeId == asTYPEID_INT64)
+        dict->Set(key, *(asINT64*)address);
+    else if(typeId == asTYPEID_DOUBLE)
+        dict->Set(key, *(double*)address);
+    else
+        dict->Set(key, address, typeId);
+}
+
+CScriptDictionary * DeepCopy(JSONTypeIds const& ids, CScriptDictionary const* dict, size_t depth)
+{
+    CheckDepth(depth+1);
+
+    CScriptDictionary * r = CScriptDictionary::Create(ids.engine);
+
+    try
+    {
+        for(auto & i : *dict)
+        {
+            if(void * copy = DeepCopyContainer(ids, i.GetTypeId(), i.GetAddressOfValue(), depth+1))
+            {
+                r->Set(i.GetKey(), &copy, i.GetTypeId() | asTYPEID_OBJHANDLE);
+                ids.engine->ReleaseScriptObject(copy, ids.engine->GetTypeInfoById(i.GetTypeId()));
+            }
+            else
+                SetDictValue(r, i.GetKey(), i.GetTypeId(), const_cast<void*>(i.GetAddressOfValue()));
+        }
+    }
+    catch(...)
+    {
+        r->Release();
+        throw;
+    }
+
+    return r;
+}
+
+CScriptArray * DeepCopy(JSONTypeIds const& ids, CScriptArray const* array, size_t depth)
+{
+    CheckDepth(depth+1);
+
+    CScriptArray * r = CScriptArray::Create(array->GetArrayObjectType(), array->GetSize());
+    int typeId = array->GetElementTypeId();
+
+    try
+    {
+        for(asUINT i = 0; i < array->GetSize(); ++i)
+        {
+            if(void * copy = DeepCopyContainer(ids, typeId, array->At(i), depth+1))
+            {
+                r->SetValue(i, (typeId & asTYPEID_OBJHANDLE)? (void*)&copy : copy);
+                ids.engine->ReleaseScriptObject(copy, ids.engine->GetTypeInfoById(typeId));
+            }
+            else
+                r->SetValue(i, const_cast<void*>(array->At(i)));
+        }
+    }
+    catch(...)
+    {
+        r->Release();
+        throw;
+    }
+
+    return r;
+}
+
+struct JSONDiffWriter
+{
+    JSONDiffWriter(std::ostream & stream, asIScriptEngine * engine, JSONArena & arena) :
+        stream(stream),
+        ids(engine),
+        path(arena),
+        a_stack(arena),
+        object_stack(arena)
+    {
+    }
+
+    void Op(const char * op, int typeId = 0, void const* value = nullptr)
+    {
+        stream << (first? "{ \"op\": \"" : ", { \"op\": \"") << op << "\", \"path\": \"";
+        WriteEscapedString(stream, path.data(), path.data() + path.size());
+        stream << '"';
+
+        if(value)
+        {
+            stream << ", \"value\": ";
+            asToJSON_String(object_stack, stream, ids.engine, typeId, value, 0, 1, true);
+        }
+
+        stream << " }";
+        first = false;
+    }
+
+//appends /token to the pointer, escaping '~' and '/'.
+    size_t PushKey(std::string const& key)
+    {
+        size_t length = path.size();
+        path += '/';
+
+        for(char c : key)
+        {
+            if(c == '~')      path += "~0";
+            else if(c == '/') path += "~1";
+            else              path += c;
+        }
+
+        return length;
+    }
+
+    size_t PushIndex(asUINT index)
+    {
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), "/%u", index);
+
+        size_t length = path.size();
+        path += buffer;
+        return length;
+    }
+
+    bool OnStack(void const* a, void const* b) const
+    {
+        for(size_t i = 0; i < object_stack.size(); ++i)
+        {
+            if(a_stack[i] == a || a_stack[i] == b || object_stack[i] == a || object_stack[i] == b)
+                return true;
+        }
+
+        return false;
+    }
+
+//object_stack only holds b's side so values written by Op nest from the same depth as b.
+    void Push(void const* a, void const* b)
+    {
+        CheckDepth(object_stack.size()+1);
+        a_stack.push_back(a);
+        object_stack.push_back(b);
+    }
+
+    void Pop()
+    {
+        a_stack.pop_back();
+        object_stack.pop_back();
+    }
+
+    void Diff(int typeA, void const* a, int typeB, void const* b)
+    {
+        void const* objA = Deref(typeA, a);
+        void const* objB = Deref(typeB, b);
+
+        if(objA && objB && objA != objB && !OnStack(objA, objB))
+        {
+            if(ids.IsDictionary(typeA) && ids.IsDictionary(typeB))
+            {
+                Diff((CScriptDictionary const*)objA, (CScriptDictionary const*)objB);
+                return;
+            }
+
+            if(ids.IsArray(typeA) && ids.IsArray(typeB)
+            && ((CScriptArray const*)objA)->GetElementTypeId() == ((CScriptArray const*)objB)->GetElementTypeId())
+            {
+                Diff((CScriptArray const*)objA, (CScriptArray const*)objB);
+                return;
+            }
+        }
+
+        if(!ValuesEqual(ids, typeA, a, typeB, b, object_stack.size()))
+            Op("replace", typeB, b);
+    }
+
+    void Diff(CScriptDictionary const* a, CScriptDictionary const* b)
+    {
+        Push(a, b);
+
+        for(auto & i : *a)
+        {
+            if(!CanSerialize(ids.engine, i.GetTypeId()))
+                continue;
+
+            size_t length = PushKey(i.GetKey());
+            auto j = b->find(i.GetKey());
+
+            if(j == b->end() || !CanSerialize(ids.engine, j.GetTypeId()))
+                Op("remove");
+            else
+                Diff(i.GetTypeId(), i.GetAddressOfValue(), j.GetTypeId(), j.GetAddressOfValue());
+
+            path.resize(length);
+        }
+
+        for(auto & j : *b)
+        {
+            if(!CanSerialize(ids.engine, j.GetTypeId()))
+                continue;
+
+            auto i = a->find(j.GetKey());
+
+            if(i != a->end() && CanSerialize(ids.engine, i.GetTypeId()))
+                continue;
+
+            size_t length = PushKey(j.GetKey());
+            Op("add", j.GetTypeId(), j.GetAddressOfValue());
+            path.resize(length);
+        }
+
+        Pop();
+    }
+
+//element by element, then trim or extend the tail; no attempt at finding moved runs.
+    void Diff(CScriptArray const* a, CScriptArray const* b)
+    {
+        Push(a, b);
+
+        int typeId = a->GetElementTypeId();
+        asUINT common = std::min(a->GetSize(), b->GetSize());
+
+        for(asUINT i = 0; i < common; ++i)
+        {
+            size_t length = PushIndex(i);
+            Diff(typeId, a->At(i), typeId, b->At(i));
+            path.resize(length);
+        }
+
+        for(asUINT i = a->GetSize(); i > common; --i)
+        {
+            size_t length = PushIndex(i-1);
+            Op("remove");
+            path.resize(length);
+        }
+
+        for(asUINT i = common; i < b->GetSize(); ++i)
+        {
+            size_t length = PushIndex(i);
+            Op("add", typeId, b->At(i));
+            path.resize(length);
+        }
+
+        Pop();
+    }
+
+    std::ostream    & stream;
+    JSONTypeIds       ids;
+    JSONString        path;
+    JSONObjectStack   a_stack;
+    JSONObjectStack   object_stack;
+    bool              first{true};
+};
+
+void asJSONDiff(std::ostream & stream, CScriptDictionary const* a, CScriptDictionary const* b)
+{
+    if(a == nullptr || b == nullptr)
+        throw std::invalid_argument("null dictionary");
+
+    JSONScratchScope scratch;
+    JSONDiffWriter writer(stream, a->GetEngine(), scratch.arena);
+
+    stream << "[";
+    writer.Diff(a, b);
+    stream << "]";
+}
+
+struct JSONPatcher
+{
+    JSONPatcher(CScriptDictionary * root) :
+        ids(root->GetEngine()),
+        root(root)
+    {
+    }
+
+    struct Location
+    {
+        int         typeId;
+        void      * container;
+        std::string token;
+    };
+
+//splits off the last token of the pointer, the rest has to name an existing dictionary or array.
+    Location Resolve(std::string const& pointer)
+    {
+        if(pointer.empty() || pointer[0] != '/')
+            throw std::runtime_error("bad JSON pointer: \"" + pointer + "\"");
+
+        Location r{ids.asTypeIdDictionary, root, {}};
+        size_t begin = 1;
+
+        for(;;)
+        {
+            size_t end = pointer.find('/', begin);
+            Unescape(pointer, begin, end == std::string::npos? pointer.size() : end, r.token);
+
+            if(end == std::string::npos)
+                return r;
+
+            int    typeId{};
+            void * address{};
+
+            if(!GetChild(r, typeId, address) || Deref(typeId, address) == nullptr
+            || (!ids.IsDictionary(typeId) && !ids.IsArray(typeId)))
+                throw std::runtime_error("path not found: \"" + pointer.substr(0, end) + "\"");
+
+            r.typeId    = typeId;
+            r.container = Deref(typeId, address);
+            begin       = end+1;
+        }
+    }
+
+    static void Unescape(std::string const& pointer, size_t begin, size_t end, std::string & out)
+    {
+        out.clear();
+
+        for(size_t i = begin; i < end; ++i)
+        {
+            if(pointer[i] == '~' && i+1 < end && (pointer[i+1] == '0' || pointer[i+1] == '1'))
+                out += (pointer[++i] == '0')? '~' : '/';
+            else
+                out += pointer[i];
+        }
+    }
+
+    static bool ParseIndex(std::string const& token, asUINT size, bool allowEnd, asUINT & index)
+    {
+        if(allowEnd && token == "-")
+        {
+            index = size;
+            return true;
+        }
+
+        if(token.empty() || token.size() > 10 || (token[0] == '0' && token.size() > 1))
+            return false;
+
+        asINT64 value = 0;
+
+        for(char c : token)
+        {
+            if(c < '0' || '9' < c)
+                return false;
+
+            value = value*10 + (c - '0');
+        }
+
+        index = (asUINT)value;
+        return value <= (allowEnd? size : size-1) && (allowEnd || size > 0);
+    }
+
+    bool GetChild(Location const& loc, int & typeId, void *& address)
+    {
+        if(ids.IsDictionary(loc.typeId))
+        {
+            auto dict = (CScriptDictionary*)loc.container;
+            auto itr  = dict->find(loc.token);
+
+            if(itr == dict->end())
+                return false;
+
+            typeId  = itr.GetTypeId();
+            address = const_cast<void*>(itr.GetAddressOfValue());
+            return true;
+        }
+
+        auto   array = (CScriptArray*)loc.container;
+        asUINT index;
+
+        if(!ParseIndex(loc.token, array->GetSize(), false, index))
+            return false;
+
+        typeId  = array->GetElementTypeId();
+        address = array->At(index);
+        return true;
+    }
+
+//gets a value into the form SetValue/InsertAt want for this array, converting numbers as needed.
+//if an array had to be made for the value it's left in temporary, for the caller to release once it's stored.
+    void * ToElement(CScriptArray * array, int typeId, void * address, asQWORD & buffer, CScriptArray *& temporary)
+    {
+        int elementType = array->GetElementTypeId();
+
+        if(!(elementType & asTYPEID_MASK_OBJECT))
+        {
+            asINT64 i{};
+            double  d{};
+            bool    isFloat{};
+
+            if(elementType == asTYPEID_BOOL && typeId == asTYPEID_BOOL)
+                return address;
+
+            if(elementType != asTYPEID_BOOL && ReadNumber(typeId, address, i, d, isFloat))
+            {
+                if(!WriteNumber(elementType, &buffer, i, d, isFloat))
+                    throw std::runtime_error("type mismatch: " + std::string(isFloat? std::to_string(d) : std::to_string(i))
+                        + " doesn't fit in " + std::string(GetFullTypeName(ids.engine, elementType, GetScratchArena()).c_str()));
+
+                return &buffer;
+            }
+
+            if((elementType & asTYPEID_MASK_SEQNBR) == elementType && ids.IsString(typeId))
+            {
+                auto typeInfo = ids.engine->GetTypeInfoById(elementType);
+                auto & name   = *(std::string const*)Deref(typeId, address);
+
+                for(asUINT n = 0; typeInfo && n < typeInfo->GetEnumValueCount(); ++n)
+                {
+                    int value = 0;
+
+                    if(name == typeInfo->GetEnumValueByIndex(n, &value))
+                    {
+                        *(int32_t*)&buffer = value;
+                        return &buffer;
+                    }
+                }
+            }
+        }
+//null parses as an unset dictionary@, it fits any handle.
+        else if((elementType & asTYPEID_OBJHANDLE) && (typeId & asTYPEID_OBJHANDLE) && Deref(typeId, address) == nullptr)
+        {
+            *(void**)&buffer = nullptr;
+            return &buffer;
+        }
+        else if(JSONTypeIds::Strip(elementType) == JSONTypeIds::Strip(typeId))
+        {
+            void * object = Deref(typeId, address);
+
+            if(elementType & asTYPEID_OBJHANDLE)
+            {
+                *(void**)&buffer = object;
+                return &buffer;
+            }
+
+            if(object)
+                return object;
+        }
+//"[]" parses as array<dictionary@>, but empty it fits any array type, so store a new one of the element's type.
+        else if(ids.IsArray(elementType) && ids.IsArray(typeId)
+             && Deref(typeId, address) && ((CScriptArray const*)Deref(typeId, address))->GetSize() == 0)
+        {
+            temporary = CScriptArray::Create(ids.engine->GetTypeInfoById(elementType));
+
+            if(elementType & asTYPEID_OBJHANDLE)
+            {
+                *(void**)&buffer = temporary;
+                return &buffer;
+            }
+
+            return temporary;
+        }
+
+        throw std::runtime_error("type mismatch: value can't be stored in " + std::string(GetFullTypeName(ids.engine, array->GetArrayTypeId(), GetScratchArena()).c_str()));
+    }
+
+    void Put(Location const& loc, int typeId, void * address, bool insert)
+    {
+        if(ids.IsDictionary(loc.typeId))
+        {
+            SetDictValue((CScriptDictionary*)loc.container, loc.token, typeId, address);
+            return;
+        }
+
+        auto    array = (CScriptArray*)loc.container;
+        asUINT  index;
+        asQWORD buffer{};
+
+        if(!ParseIndex(loc.token, array->GetSize(), insert, index))
+            throw std::runtime_error("bad array index: \"" + loc.token + "\"");
+
+        CScriptArray * temporary{};
+        void * element = ToElement(array, typeId, address, buffer, temporary);
+
+        if(insert)
+            array->InsertAt(index, element);
+        else
+            array->SetValue(index, element);
+
+        if(temporary)
+            temporary->Release();
+    }
+
+    void Remove(Location const& loc)
+    {
+        if(ids.IsDictionary(loc.typeId))
+        {
+            ((CScriptDictionary*)loc.container)->Delete(loc.token);
+            return;
+        }
+
+        auto   array = (CScriptArray*)loc.container;
+        asUINT index;
+
+        if(!ParseIndex(loc.token, array->GetSize(), false, index))
+            throw std::runtime_error("bad array index: \"" + loc.token + "\"");
+
+        array->RemoveAt(index);
+    }
+
+    void Apply(CScriptDictionary const* op)
+    {
+        std::string name, path, from;
+
+        if(!op->Get("op", &name, ids.asTypeIdString) || !op->Get("path", &path, ids.asTypeIdString))
+            throw std::runtime_error("patch operation needs \"op\" and \"path\"");
+
+        auto value = op->find("value");
+        bool needsValue = (name == "add" || name == "replace" || name == "test");
+
+        if(needsValue && value == op->end())
+            throw std::runtime_error(name + " needs a \"value\"");
+
+        if((name == "move" || name == "copy") && !op->Get("from", &from, ids.asTypeIdString))
+            throw std::runtime_error(name + " needs \"from\"");
+
+        if(path.empty())
+        {
+            ApplyToRoot(name, needsValue? value.GetTypeId() : 0, needsValue? value.GetAddressOfValue() : nullptr);
+            return;
+        }
+
+        Location loc = Resolve(path);
+        int    typeId{};
+        void * address{};
+        bool   exists = GetChild(loc, typeId, address);
+
+        if(name == "add")
+        {
+            Put(loc, value.GetTypeId(), const_cast<void*>(value.GetAddressOfValue()), true);
+        }
+        else if(name == "remove")
+        {
+            if(!exists)
+                throw std::runtime_error("path not found: \"" + path + "\"");
+
+            Remove(loc);
+        }
+        else if(name == "replace")
+        {
+            if(!exists)
+                throw std::runtime_error("path not found: \"" + path + "\"");
+
+            Put(loc, value.GetTypeId(), const_cast<void*>(value.GetAddressOfValue()), false);
+        }
+        else if(name == "test")
+        {
+            if(!exists || !ValuesEqual(ids, typeId, address, value.GetTypeId(), value.GetAddressOfValue()))
+                throw std::runtime_error("test failed: \"" + path + "\"");
+        }
+        else if(name == "move" || name == "copy")
+        {
+            if(name == "move" && (path == from || path.compare(0, from.size()+1, from + "/") == 0))
+            {
+                if(path == from) return;
+                throw std::runtime_error("can't move \"" + from + "\" into itself");
+            }
+
+            Location source = Resolve(from);
+
+            if(!GetChild(source, typeId, address))
+                throw std::runtime_error("path not found: \"" + from + "\"");
+
+//hold on to the value in a scratch dictionary, removing the source may free it.
+            CScriptDictionary * holder = CScriptDictionary::Create(ids.engine);
+
+            try
+            {
+                void * copy = (name == "copy")? DeepCopyContainer(ids, typeId, address) : nullptr;
+
+                if(copy)
+                {
+                    holder->Set("", &copy, typeId | asTYPEID_OBJHANDLE);
+                    ids.engine->ReleaseScriptObject(copy, ids.engine->GetTypeInfoById(typeId));
+                }
+                else
+                    SetDictValue(holder, "", typeId, address);
+
+                if(name == "move")
+                {
+                    Remove(source);
+                    loc = Resolve(path);
+                }
+
+                auto held = holder->find("");
+                Put(loc, held.GetTypeId(), const_cast<void*>(held.GetAddressOfValue()), true);
+            }
+            catch(std::exception &)
+            {
+                holder->Release();
+                throw;
+            }
+
+            holder->Release();
+        }
+        else
+            throw std::runtime_error("unknown patch operation: \"" + name + "\"");
+    }
+
+//"" names the whole document, which can only be tested or swapped for another dictionary.
+    void ApplyToRoot(std::string const& name, int typeId, void const* address)
+    {
+        if(name == "test")
+        {
+            if(!ValuesEqual(ids, ids.asTypeIdDictionary, root, typeId, address))
+                throw std::runtime_error("test failed: \"\"");
+            return;
+        }
+
+        if((name == "add" || name == "replace") && ids.IsDictionary(typeId) && Deref(typeId, address))
+        {
+            *root = *(CScriptDictionary const*)Deref(typeId, address);
+            return;
+        }
+
+        throw std::runtime_error(name + " can't be applied to the whole document");
+    }
+
+    JSONTypeIds         ids;
+    CScriptDictionary * root;
+};
+
+void asJSONApplyPatch(CScriptDictionary * dict, std::string patch)
+{
+    JSONScratchScope scratch;
+    JSONTape tape(scratch.arena);
+    TokenizeDocument(&patch[0], patch.size(), tape, g_ParseLimits);
+
+    if(tape[0].type != JSONNode::Array)
+        throw std::runtime_error("JSON Patch must be an array");
+
+    JSONTapeRange stream(tape, dict->GetEngine(), scratch.arena);
+    JSON_ANY value{};
+    int typeId{};
+
+    asFromJSON_String(stream, value, typeId);
+    CScriptArray * ops = (CScriptArray*)value.obj;
+
+    JSONPatcher patcher(dict);
+
+    try
+    {
+        if(!patcher.ids.IsDictionary(ops->GetElementTypeId()))
+            throw std::runtime_error("JSON Patch must be an array of objects");
+
+        for(asUINT i = 0; i < ops->GetSize(); ++i)
+            patcher.Apply((CScriptDictionary const*)Deref(ops->GetElementTypeId(), ops->At(i)));
+    }
+    catch(std::exception &)
+    {
+        ops->Release();
+        throw;
+    }
+
+    ops->Release();
+}
+
+/* parsing straight into typed objects */
+
+static const char * GetNodeTypeName(JSONNode::Type type)
+{
+    static const char * names[] = { "object", "array", "string", "integer", "number", "bool", "null" };
+    return names[type];
+}
+
+static std::runtime_error TypeMismatch(JSONTapeRange & stream, const char * name, int typeId)
+{
+    return std::runtime_error(std::string("can't read ") + GetNodeTypeName(stream.front().type) + " into '" + name
+        + "' of type " + GetFullTypeName(stream.engine, typeId, stream.arena).c_str());
+}
+
+static void ReadInto(JSONTapeRange & stream, int typeId, void * address, const char * name, size_t levels);
+
+//stream.front() is an Object, keys without a matching property are skipped without building anything.
+static void ReadObject(JSONTapeRange & stream, JSONPropertyPlan const& plan, void * object, size_t levels)
+{
+    uint32_t length = stream.front().length;
+    stream.popFront();
+
+    for(uint32_t i = 0; i < length; ++i)
+    {
+        JSONNode const& key = stream.front();
+        stream.popFront();
+
+        auto property = plan.Find(key.str, key.length);
+
+        if(property == nullptr)
+        {
+            stream.skip();
+            continue;
+        }
+
+        ReadInto(stream, property->typeId, const_cast<void*>(property->Address(object)), property->name.c_str(), levels);
+    }
+}
+
+//levels is how many more objects/arrays may be entered, it starts at limits.maxDepth.
+void ReadInto(JSONTapeRange & stream, int typeId, void * address, const char * name, size_t levels)
+{
+    JSONNode const& node = stream.front();
+
+    if(node.type <= JSONNode::Array)
+    {
+        if(levels == 0)
+            throw std::runtime_error(std::string("'") + name + "' is nested too deeply");
+
+        --levels;
+    }
+
+//a handle is cleared, anything else can't be null.
+    if(node.type == JSONNode::Null)
+    {
+        if(!(typeId & asTYPEID_OBJHANDLE))
+            throw TypeMismatch(stream, name, typeId);
+
+        if(void * old = *(void**)address)
+            stream.engine->ReleaseScriptObject(old, stream.engine->GetTypeInfoById(typeId));
+
+        *(void**)address = nullptr;
+        stream.popFront();
+        return;
+    }
+
+    if(typeId == asTYPEID_BOOL)
+    {
+        if(node.type != JSONNode::Bool)
+            throw TypeMismatch(stream, name, typeId);
+
+        *(bool*)address = node.boolean;
+        stream.popFront();
+        return;
+    }
+
+    if(typeId > asTYPEID_BOOL && typeId <= asTYPEID_DOUBLE)
+    {
+        if(node.type != JSONNode::Int && node.type != JSONNode::Double)
+            throw TypeMismatch(stream, name, typeId);
+
+        bool stored = false;
+
+        switch(typeId)
+        {
+        case asTYPEID_INT8:   stored = StoreNumber<int8_t>(node, address); break;
+        case asTYPEID_INT16:  stored = StoreNumber<int16_t>(node, address); break;
+        case asTYPEID_INT32:  stored = StoreNumber<int32_t>(node, address); break;
+        case asTYPEID_INT64:  stored = StoreNumber<int64_t>(node, address); break;
+        case asTYPEID_UINT8:  stored = StoreNumber<uint8_t>(node, address); break;
+        case asTYPEID_UINT16: stored = StoreNumber<uint16_t>(node, address); break;
+        case asTYPEID_UINT32: stored = StoreNumber<uint32_t>(node, address); break;
+        case asTYPEID_UINT64: stored = StoreNumber<uint64_t>(node, address); break;
+        case asTYPEID_FLOAT:  stored = StoreNumber<float>(node, address); break;
+        case asTYPEID_DOUBLE: stored = StoreNumber<double>(node, address); break;
+        default: break;
+        }
+
+        if(!stored)
+            throw TypeMismatch(stream, name, typeId);
+
+        stream.popFront();
+        return;
+    }
+
+    asITypeInfo * typeInfo = stream.engine->GetTypeInfoById(typeId);
+
+//enums, saved by name when the value has one.
+    if((typeId & asTYPEID_MASK_SEQNBR) == typeId)
+    {
+        if(node.type == JSONNode::Int)
+        {
+            if(!StoreNumber<int32_t>(node, address))
+                throw TypeMismatch(stream, name, typeId);
+        }
+        else if(node.type != JSONNode::String)
+            throw TypeMismatch(stream, name, typeId);
+        else
+        {
+            asUINT i = 0, N = typeInfo->GetEnumValueCount();
+
+            for(; i < N; ++i)
+            {
+                int enumValue = 0;
+                const char * enumName = typeInfo->GetEnumValueByIndex(i, &enumValue);
+
+                if(strlen(enumName) == node.length && memcmp(enumName, node.str, node.length) == 0)
+                {
+                    *(int32_t*)address = enumValue;
+                    break;
+                }
+            }
+
+            if(i == N)
+                throw std::runtime_error(std::string("'") + name + "': " + std::string(node.str, node.length) + " is not a " + typeInfo->GetName());
+        }
+
+        stream.popFront();
+        return;
+    }
+
+    if(typeId == stream.asTypeIdString)
+    {
+        if(node.type != JSONNode::String)
+            throw TypeMismatch(stream, name, typeId);
+
+        ((std::string*)address)->assign(node.str, node.length);
+        stream.popFront();
+        return;
+    }
+
+    bool is_handle = (typeId & asTYPEID_OBJHANDLE) != 0;
+    void * object  = is_handle? *(void**)address : address;
+
+    if(strcmp(typeInfo->GetName(), "dictionary") == 0)
+    {
+        if(node.type != JSONNode::Object)
+            throw TypeMismatch(stream, name, typeId);
+
+        JSON_ANY value{};
+        int valueTypeId{};
+        asFromJSON_String(stream, value, valueTypeId);
+
+        if(is_handle)
+        {
+            if(object)
+                stream.engine->ReleaseScriptObject(object, typeInfo);
+
+            *(void**)address = value.obj;
+        }
+        else
+        {
+            stream.engine->AssignScriptObject(object, value.obj, typeInfo);
+            stream.engine->ReleaseScriptObject(value.obj, typeInfo);
+        }
+
+        return;
+    }
+
+    if(strcmp(typeInfo->GetName(), "array") == 0)
+    {
+        if(node.type != JSONNode::Array)
+            throw TypeMismatch(stream, name, typeId);
+
+        if(object == nullptr)
+            *(void**)address = object = CScriptArray::Create(typeInfo);
+
+        auto array = (CScriptArray*)object;
+        array->Resize(node.length);
+        stream.popFront();
+
+        for(asUINT i = 0; i < array->GetSize(); ++i)
+            ReadInto(stream, array->GetElementTypeId(), array->At(i), name, levels);
+
+        return;
+    }
+
+    if(typeId & asTYPEID_SCRIPTOBJECT)
+    {
+        if(node.type != JSONNode::Object)
+            throw TypeMismatch(stream, name, typeId);
+
+        if(object == nullptr)
+        {
+            object = stream.engine->CreateScriptObject(typeInfo);
+
+            if(object == nullptr)
+                throw std::runtime_error(std::string("'") + name + "': can't create an instance of " + typeInfo->GetName());
+
+            *(void**)address = object;
+        }
+
+//fill in the instance's own type, the handle may be to a base class.
+        ReadObject(stream, GetPropertyPlan(((asIScriptObject*)object)->GetObjectType()), object, levels);
+        return;
+    }
+
+    if(!is_handle && (typeInfo->GetFlags() & asOBJ_VALUE))
+    {
+        auto & plan = GetPropertyPlan(typeInfo);
+
+        if(!plan.properties.empty())
+        {
+            if(node.type != JSONNode::Object)
+                throw TypeMismatch(stream, name, typeId);
+
+            ReadObject(stream, plan, object, levels);
+            return;
+        }
+    }
+
+    throw TypeMismatch(stream, name, typeId);
+}
+
+bool asFromJSON_Into(char * data, size_t size, asIScriptEngine * engine, void * ref, int typeId, JSONParseLimits const& limits)
+{
+    if(!StartsWithObject(data, size))
+        return false;
+
+    JSONScratchScope scratch;
+    JSONTape tape(scratch.arena);
+    TokenizeDocument(data, size, tape, limits);
+
+    JSONTapeRange stream(tape, engine, scratch.arena);
+    ReadInto(stream, typeId, ref, "document", limits.maxDepth);
+
+    return true;
+}
+
+bool asFromJSON_String(std::string const& stream, asIScriptEngine * engine, void * ref, int typeId)
+{
+    JSONScratchScope scratch;
+    char * contents = CopyDocument(stream, scratch.arena, g_ParseLimits);
+
+    return asFromJSON_Into(contents, stream.size(), engine, ref, typeId, g_ParseLimits);
+}
+
+/* shared parsed-document cache for FromJsonFile */
+
+static const asPWORD JSON_FILE_CACHE = 0x4A534F43;
+
+struct JSONFileCache
+{
+    struct Entry
+    {
+        std::string         path;
+        int64_t             mtime;
+        size_t              size;
+        CScriptDictionary * dict;
+    };
+
+    typedef std::list<Entry> EntryList;
+
+    static JSONFileCache * Get(asIScriptEngine * engine)
+    {
+        return (JSONFileCache*)engine->GetUserData(JSON_FILE_CACHE);
+    }
+
+    static void Cleanup(asIScriptEngine * engine)
+    {
+        delete Get(engine);
+    }
+
+    JSONFileCache(asIScriptEngine * engine, size_t maxBytes) :
+        engine(engine),
+        maxBytes(maxBytes)
+    {
+    }
+
+    ~JSONFileCache()
+    {
+        for(auto & e : entries)
+            e.dict->Release();
+    }
+
+//mtime in the finest units the platform has (100ns on windows, ns elsewhere), whole seconds miss quick rewrites of the same length.
+    static bool Stat(std::string const& path, int64_t & mtime, size_t & size)
+    {
+#ifdef _WIN32
+        WIN32_FILE_ATTRIBUTE_DATA info;
+        if(!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &info))
+            return false;
+
+        mtime = ((int64_t)info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime;
+        size  = (size_t)(((uint64_t)info.nFileSizeHigh << 32) | info.nFileSizeLow);
+#else
+        struct stat info;
+        if(stat(path.c_str(), &info) != 0)
+            return false;
+
+#ifdef __APPLE__
+        mtime = (int64_t)info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+        mtime = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+        size  = (size_t)info.st_size;
+#endif
+        return true;
+    }
+
+//new reference to the cached tree for path, parsing and caching it if it is missing or the file changed.
+    CScriptDictionary * Acquire(std::string const& path)
+    {
+        int64_t mtime{};
+        size_t size{};
+
+        if(!Stat(path, mtime, size))
+            throw std::system_error(std::make_error_code(std::errc::no_such_file_or_directory), path);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
 
-    bool r = false;
+            auto itr = lookup.find(path);
 
-    if(!compressWhitespace)
-        indent.resize(depth, '\t');
+            if(itr != lookup.end())
+            {
+                if(itr->second->mtime == mtime && itr->second->size == size)
+                {
+                    ++stats.hits;
+                    entries.splice(entries.begin(), entries, itr->second);
+                    itr->second->dict->AddRef();
+                    return itr->second->dict;
+                }
 
-    stream << "[";
+                Erase(itr->second);
+            }
 
-    for(asUINT i = 0; i != array->GetSize(); ++i)
-    {
-        if(i != 0)
+            ++stats.misses;
+        }
+
+//parse without the lock held, other files can be served meanwhile.
+        CScriptDictionary * dict = asFromJSON_File(path, engine);
+
+        if(dict == nullptr)
+            return nullptr;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto itr = lookup.find(path);
+        if(itr != lookup.end())
+            Erase(itr->second);
+
+        if(size <= maxBytes)
         {
-                stream << ", ";
+            dict->AddRef();
+            entries.push_front({path, mtime, size, dict});
+            lookup[path] = entries.begin();
+            stats.bytes += size;
+
+            Trim();
         }
 
-        r |= asToJSON_String(object_stack, stream, array->GetElementTypeId(), array->At(i), depth, indent, compressWhitespace);
+        return dict;
     }
 
-    stream << "]";
+    void Invalidate(std::string const& path)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
 
+        if(path.empty())
+        {
+            while(!entries.empty())
+                Erase(entries.begin());
 
-    assert(object_stack.back() == array);
-    object_stack.pop_back();
+            return;
+        }
 
-    return r;
-}
+        auto itr = lookup.find(path);
 
-static bool asToJSON_String(std::vector<void const*> & object_stack, std::ostream & stream, const char * field, int typeId, void const* object, int depth, std::string indent, bool compressWhitespace)
-{
-    stream << "\"" << EscapeString(field) << "\": ";
-    return asToJSON_String(object_stack, stream, typeId, object, depth, std::move(indent), compressWhitespace);
-}
+        if(itr != lookup.end())
+            Erase(itr->second);
+    }
 
+    JSONFileCacheStats GetStats()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
 
-static bool asToJSON_String(std::vector<void const*> & object_stack, std::ostream & stream, int typeId, void const* object, int depth, std::string indent, bool compressWhitespace)
-{
-    if(typeId & asTYPEID_OBJHANDLE && object)
+        JSONFileCacheStats r = stats;
+        r.entries = entries.size();
+        return r;
+    }
+
+    void SetLimit(size_t bytes)
     {
-        object = *(void**)object;
+        std::lock_guard<std::mutex> lock(mutex);
+
+        maxBytes = bytes;
+        Trim();
     }
 
-    if(object == nullptr)
+private:
+    void Erase(EntryList::iterator itr)
     {
-        stream << "null";
-        return false;
+        stats.bytes -= itr->size;
+        itr->dict->Release();
+        lookup.erase(itr->path);
+        entries.erase(itr);
     }
 
-    for(auto & c : object_stack)
+//least recently used are at the back.
+    void Trim()
     {
-        if(c == object)
+        while(stats.bytes > maxBytes && !entries.empty())
         {
-            stream << "null";
-            return false;
+            Erase(std::prev(entries.end()));
+            ++stats.evictions;
         }
     }
 
-    stream.setf(std::ios::fixed,std::ios::floatfield);
+    asIScriptEngine * const engine;
+    size_t                  maxBytes;
+    std::mutex              mutex;
+    EntryList               entries;
+    std::unordered_map<std::string, EntryList::iterator> lookup;
+    JSONFileCacheStats      stats{};
+};
 
-    switch(typeId)
-    {
-    case asTYPEID_VOID:   stream << "null"; return false;
-    case asTYPEID_BOOL:   stream <<((*(const bool*)object)? "true" : "false"); return false;
-    case asTYPEID_INT8:   stream << *(const int8_t*)object; return false;
-    case asTYPEID_INT16:  stream << *(const  int16_t*)object; return false;
-    case asTYPEID_INT32:  stream << *(const  int32_t*)object; return false;
-    case asTYPEID_INT64:  stream << *(const  int64_t*)object; return false;
-    case asTYPEID_UINT8:  stream << *(const uint8_t*)object; return false;
-    case asTYPEID_UINT16: stream << *(const uint16_t*)object; return false;
-    case asTYPEID_UINT32: stream << *(const uint32_t*)object; return false;
-    case asTYPEID_UINT64: stream << *(const uint64_t*)object; return false;
-    case asTYPEID_FLOAT:
+void asEnableJSONFileCache(asIScriptEngine * engine, size_t maxBytes)
+{
+    if(JSONFileCache * cache = JSONFileCache::Get(engine))
     {
-        char buffer[16];
-        snprintf(buffer, sizeof(buffer), "%g", *(const float*)object);
+        if(maxBytes == 0)
+        {
+            engine->SetUserData(nullptr, JSON_FILE_CACHE);
+            delete cache;
+        }
+        else
+            cache->SetLimit(maxBytes);
 
-        stream << buffer;
-        return false;
+        return;
     }
-    case asTYPEID_DOUBLE:
-    {
-        char buffer[16];
-        snprintf(buffer, sizeof(buffer), "%lg", *(const double*)object);
 
-        stream << buffer;
-        return false;
-    }
-    default:
-        break;
-    }
+    if(maxBytes == 0)
+        return;
 
-    auto typeInfo = asGetActiveContext()->GetEngine()->GetTypeInfoById(typeId);
+    engine->SetUserData(new JSONFileCache(engine, maxBytes), JSON_FILE_CACHE);
+    engine->SetEngineUserDataCleanupCallback(&JSONFileCache::Cleanup, JSON_FILE_CACHE);
+}
 
-    if((typeId & asTYPEID_MASK_SEQNBR) == typeId)
+//path is already normalized (or empty for everything).
+static void InvalidateCachedFile(asIScriptEngine * engine, std::string const& path)
+{
+    if(JSONFileCache * cache = JSONFileCache::Get(engine))
+        cache->Invalidate(path);
+}
+
+void asInvalidateJSONFileCache(asIScriptEngine * engine, std::string const& path)
+{
+    if(path.empty())
     {
-        auto N = typeInfo->GetEnumValueCount();
-        for(auto i = 0u; i < N; ++i)
-        {
-            int enumValue = 0;
-            const char * name = typeInfo->GetEnumValueByIndex(i, &enumValue);
+        InvalidateCachedFile(engine, path);
+        return;
+    }
 
-            if(enumValue == *(const  int32_t*)object)
-            {
-                stream << '\"' << name << '\"';
-                return false;
-            }
-        }
+    std::string normalized;
+    InvalidateCachedFile(engine, NormalizePath(path, normalized));
+}
 
-        stream << *(const  int32_t*)object;
-        return false;
+JSONFileCacheStats asGetJSONFileCacheStats(asIScriptEngine * engine)
+{
+    JSONFileCache * cache = JSONFileCache::Get(engine);
+    return cache? cache->GetStats() : JSONFileCacheStats{};
+}
+
+//path is already normalized; shared hands out the cached tree itself, otherwise callers get their own copy.
+CScriptDictionary * asLoadCachedFile(std::string const& path, asIScriptEngine * engine, bool shared)
+{
+    JSONFileCache * cache = JSONFileCache::Get(engine);
+
+    if(cache == nullptr)
+        return asFromJSON_File(path, engine);
+
+    CScriptDictionary * dict = cache->Acquire(path);
+
+    if(dict == nullptr || shared)
+        return dict;
+
+    CScriptDictionary * copy = DeepCopy(JSONTypeIds(engine), dict);
+    dict->Release();
+    return copy;
+}
+
+/* FromJsonFileAsync */
+
+//reading and tokenizing don't touch the engine so they happen here; building the script objects waits for get().
+class JSONWorkerPool
+{
+public:
+    static JSONWorkerPool & Get()
+    {
+        static JSONWorkerPool pool;
+        return pool;
     }
 
-    if(strcmp(typeInfo->GetName(), "string") == 0)
+    void Push(std::function<void()> job)
     {
-        stream << '\"' << EscapeString(*(std::string*)object) << '\"';
-        return false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+
+        wake.notify_one();
     }
 
-    if(strcmp(typeInfo->GetName(), "dictionary") == 0)
+    size_t Size() const { return threads.size(); }
+
+private:
+    JSONWorkerPool()
     {
-        return asToJSON_String(object_stack, stream, (CScriptDictionary*)object, depth, std::move(indent), compressWhitespace);
+//mostly waiting on the disk, so don't go below a few threads on small machines.
+        unsigned count = std::max(4u, std::thread::hardware_concurrency());
+
+        for(unsigned i = 0; i < count; ++i)
+            threads.emplace_back(&JSONWorkerPool::Run, this);
     }
 
-    if(strcmp(typeInfo->GetName(), "array") == 0)
+    ~JSONWorkerPool()
     {
-        return asToJSON_String(object_stack, stream, (CScriptArray*)object, depth, std::move(indent), compressWhitespace);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+            jobs.clear();
+        }
+
+        wake.notify_all();
+
+        for(auto & thread : threads)
+            thread.join();
     }
 
-    if(strcmp(typeInfo->GetName(), "dictionaryValue") == 0)
+    void Run()
     {
-        auto & value = *(CScriptDictValue*)object;
-        return asToJSON_String(object_stack, stream, value.GetTypeId(), value.GetAddressOfValue(), depth, std::move(indent), compressWhitespace);
+        for(;;)
+        {
+            std::function<void()> job;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() { return quit || !jobs.empty(); });
+
+                if(quit)
+                    return;
+
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            job();
+        }
     }
 
-    return false;
-}
+    std::mutex                         mutex;
+    std::condition_variable            wake;
+    std::deque<std::function<void()> > jobs;
+    std::vector<std::thread>           threads;
+    bool                               quit{};
+};
 
-std::string EscapeString(std::string s)
+//written by the worker, only read by the script side once ready is set.
+struct JSONAsyncLoad
 {
-    s = g_UnicodeFunc(std::move(s));
+//files at least this big get a block of their own size, so a small file doesn't hold a 64KB block until it's built.
+    static const size_t SmallBlockSize = 4*1024;
 
-    std::string out;
-    out.reserve(s.size()*2);
+    JSONAsyncLoad(std::string path) : path(std::move(path)), limits(g_ParseLimits), arena(SmallBlockSize), tape(arena) {}
 
-    for(uint32_t i = 0; i < s.size(); ++i)
+    void Run()
     {
-        if(s[i] == '\\')
+        std::string failure;
+
+        try
         {
-            out.push_back('\\');
+            size_t size{};
+            char * contents = ReadFile(path, arena, size, limits);
+
+            if(!StartsWithObject(contents, size))
+                failure = "expected '{' at start of " + path;
+            else
+                TokenizeDocument(contents, size, tape, limits);
         }
-        if(s[i] == '\"')
+        catch(std::exception & e)
         {
-            out.push_back('\\');
+            failure = e.what();
         }
 
-        out.push_back(s[i]);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            error = std::move(failure);
+            ready = true;
+        }
 
+        done.notify_all();
     }
 
-    return out;
-}
-
-struct JSONTokenRange;
+    bool IsReady()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return ready;
+    }
 
-    union JSON_ANY
+    void Wait()
     {
-        bool   boolean;
-        asINT64 _int{};
-        double  dbl;
-        void  * obj;
-    };
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return ready; });
+    }
 
-static void asFromJSON_String(JSONTokenRange & stream, CScriptDictionary * dict);
-static void asFromJSON_String(JSONTokenRange & stream, CScriptArray *& array);
-static void asFromJSON_String(JSONTokenRange & stream, JSON_ANY & value, int & typeId);
-static std::string CleanString(const char *, const char * end);
-static std::string GetFullTypeName(asIScriptEngine * engine, int typeId);
-static void FreePairVec(asIScriptEngine * engine, std::vector<std::pair<JSON_ANY, int> > vec);
+    std::string const       path;
+    JSONParseLimits const   limits;
+//owns the file contents, which the strings on the tape point into.
+    JSONArena               arena;
+    JSONTape                tape;
+    std::string             error;
 
-struct JSONTokenRange
+    std::mutex              mutex;
+    std::condition_variable done;
+    bool                    ready{};
+};
+
+struct JSONLoadRequest
 {
-    static bool ischar(char c, const char * str)
+    JSONLoadRequest(asIScriptEngine * engine, std::shared_ptr<JSONAsyncLoad> load) : engine(engine), load(std::move(load)) {}
+
+    ~JSONLoadRequest()
     {
-        for(;*str; ++str)
+        if(result)
+            result->Release();
+    }
+
+    CScriptDictionary * Get()
+    {
+        if(!built)
         {
-            if(c == *str) return true;
+            load->Wait();
+            built = true;
+            error = load->error;
+
+            if(error.empty())
+            {
+                try
+                {
+                    JSONScratchScope scratch;
+                    result = BuildDocument(load->tape, engine, scratch.arena);
+                }
+                catch(std::exception & e)
+                {
+                    error = e.what();
+                }
+            }
+
+//the tape isn't needed once the dictionary exists.
+            load.reset();
         }
 
-        return false;
+        if(!error.empty())
+            throw std::runtime_error(error);
+
+        result->AddRef();
+        return result;
     }
 
-    JSONTokenRange(std::string & string, asIScriptEngine * engine) :
-        engine(engine),
-        asTypeIdDictionary(engine->GetTypeIdByDecl("dictionary")),
-        asTypeIdString(engine->GetTypeIdByDecl("string")),
-        begin(string.data()),
-        end(string.data() + string.size()),
-        tokBegin(&string[0]),
-        tokEnd(&string[0]),
-        swapChar(tokBegin? *tokBegin : 0)
+    std::atomic<int>               refCount{1};
+    asIScriptEngine              * engine;
+    std::shared_ptr<JSONAsyncLoad> load;
+    CScriptDictionary            * result{};
+    std::string                    error;
+    bool                           built{};
+};
+
+JSONLoadRequest * asLoadFromFileAsync(std::string const& path)
+{
+    try
     {
-        popFront();
+        std::string normalized;
+        auto load = std::make_shared<JSONAsyncLoad>(NormalizePath(path, normalized));
+
+        JSONWorkerPool::Get().Push([load]() { load->Run(); });
+
+        return new JSONLoadRequest(asGetActiveContext()->GetEngine(), std::move(load));
+    }
+    catch(std::exception & e)
+    {
+        asGetActiveContext()->SetException(e.what());
     }
 
-    bool empty() const { return tokBegin >= end || *tokBegin == 0; }
-    const char * front() const { return tokBegin; }
-    const char * back() const { return tokEnd; }
+    return nullptr;
+}
 
-    void popFront()
+void asLoadRequestAddRef(JSONLoadRequest * request)
+{
+    ++request->refCount;
+}
+
+void asLoadRequestRelease(JSONLoadRequest * request)
+{
+    if(--request->refCount == 0)
+        delete request;
+}
+
+bool asLoadRequestIsReady(JSONLoadRequest const* request)
+{
+    return request->built || request->load->IsReady();
+}
+
+//blocks if the worker hasn't finished yet.
+CScriptDictionary * asLoadRequestGet(JSONLoadRequest * request)
+{
+    try
     {
-        if(empty()) return;
+        return request->Get();
+    }
+    catch(std::exception & e)
+    {
+        asGetActiveContext()->SetException(e.what());
+    }
 
-        *tokEnd = swapChar;
+    return nullptr;
+}
 
-//skip whitespace
-        for(tokBegin = tokEnd; tokBegin < end && *tokBegin && *tokBegin <= ' '; ++tokBegin) { }
+std::string asLoadRequestError(JSONLoadRequest const* request)
+{
+    if(request->built)
+        return request->error;
 
-        if(tokBegin < end && ischar(*tokBegin, ",:[]{}"))
-            tokEnd = tokBegin+1;
-        else if(tokBegin < end && ischar(*tokBegin, "'\"`"))
-        {
-            bool is_escape = false;
+    if(!request->load->IsReady())
+        return {};
 
-            for(tokEnd = tokBegin+1; tokEnd < end && *tokEnd; ++tokEnd)
-            {
-                if(*tokEnd == *tokBegin && !is_escape)
-                {
-                    ++tokEnd;
-                    break;
-                }
+    std::lock_guard<std::mutex> lock(request->load->mutex);
+    return request->load->error;
+}
 
-                is_escape = (*tokEnd == '\\');
-            }
+/* FromJsonFiles */
+
+CScriptArray * asFromJSON_Files(std::vector<std::string> const& paths, asIScriptEngine * engine, std::vector<std::string> * errors)
+{
+    std::vector<std::shared_ptr<JSONAsyncLoad> > loads;
+    loads.reserve(paths.size());
+
+    std::string normalized;
+
+    for(auto & path : paths)
+        loads.push_back(std::make_shared<JSONAsyncLoad>(NormalizePath(path, normalized)));
+
+    JSONWorkerPool & pool = JSONWorkerPool::Get();
+
+//one job per file, queued only a window ahead of the build: read files and their tapes don't pile up faster than they're built,
+//and FromJsonFileAsync jobs queued meanwhile only wait behind the window rather than the whole batch.
+    size_t const window = std::min(2 * pool.Size(), paths.size());
+    size_t queued = 0;
+
+    auto QueueNext = [&]()
+    {
+        if(queued < loads.size())
+        {
+            std::shared_ptr<JSONAsyncLoad> load = loads[queued++];
+            pool.Push([load]() { load->Run(); });
         }
-        else
+    };
+
+    while(queued < window)
+        QueueNext();
+
+    if(errors)
+        errors->assign(paths.size(), std::string());
+
+    CScriptArray * array = CScriptArray::Create(engine->GetTypeInfoByDecl("array<dictionary@>"), (asUINT)paths.size());
+
+//build in order while the workers are still reading the files further on.
+    for(size_t i = 0; i < paths.size(); ++i)
+    {
+        std::shared_ptr<JSONAsyncLoad> load = std::move(loads[i]);
+        load->Wait();
+        QueueNext();
+
+        std::string error = load->error;
+
+        if(error.empty())
         {
-    //move to end of token
-            for(tokEnd = tokBegin+1; tokEnd < end && *tokEnd; ++tokEnd)
+            try
             {
-                if(*tokEnd <= ' '
-                || ischar(*tokEnd, ",:[]{}") )
-                    break;
+                JSONScratchScope scratch;
+                CScriptDictionary * dict = BuildDocument(load->tape, engine, scratch.arena);
+
+                array->SetValue((asUINT)i, &dict);
+                dict->Release();
+            }
+            catch(std::exception & e)
+            {
+                error = e.what();
             }
         }
 
-        if(tokEnd < end)
-        {
-            swapChar = *tokEnd;
-            *tokEnd = 0;
-        }
+        if(errors)
+            (*errors)[i] = std::move(error);
     }
 
-    asIScriptEngine * const engine{};
-    const int asTypeIdDictionary;
-    const int asTypeIdString;
-
-private:
-    const char *const begin{};
-    const char *const end{};
-    char * tokBegin{};
-    char * tokEnd{};
-
-    char swapChar{};
-};
+    return array;
+}
 
-CScriptDictionary * asFromJSON_String(std::string stream,  asIScriptEngine * engine)
+static std::vector<std::string> GetPaths(CScriptArray const* paths)
 {
-    JSONTokenRange tokenizer(stream, engine);
+    std::vector<std::string> r;
+    r.reserve(paths->GetSize());
 
-    if(strcmp(tokenizer.front(), "{"))
-        return nullptr;
+    for(asUINT i = 0; i < paths->GetSize(); ++i)
+        r.push_back(*(std::string const*)paths->At(i));
 
-    CScriptDictionary * dict = CScriptDictionary::Create(engine);
+    return r;
+}
 
+CScriptArray * asLoadFromFiles(CScriptArray const* paths)
+{
     try
     {
-        asFromJSON_String(tokenizer, dict);
+        return asFromJSON_Files(GetPaths(paths), asGetActiveContext()->GetEngine());
     }
     catch(std::exception & e)
     {
-        dict->Release();
-		
-		auto ctx = asGetActiveContext();
-		
-		if(ctx)
-			ctx->SetException(e.what());
-		else
-			throw e;
+        asGetActiveContext()->SetException(e.what());
     }
 
-    return dict;
+    return nullptr;
 }
 
-void asFromJSON_String(JSONTokenRange & stream, CScriptDictionary * dict)
+CScriptArray * asLoadFromFilesWithErrors(CScriptArray const* paths, CScriptArray * errors)
 {
-    assert(strcmp(stream.front(), "{") == 0);
-
-    while(!stream.empty())
+    try
     {
-        stream.popFront();
+        std::vector<std::string> messages;
+        CScriptArray * r = asFromJSON_Files(GetPaths(paths), asGetActiveContext()->GetEngine(), &messages);
 
-        if(stream.empty())
-            throw std::runtime_error("expected string found EOF");
-//not strictly correct but i don't really care.
-        if(*stream.front() == '}')
-            break;
+        errors->Resize((asUINT)messages.size());
 
-        if(JSONTokenRange::ischar(*stream.front(), "'`\"") == false)
-            throw std::runtime_error("expected string found: \"" + std::string(stream.front()) + "\"");
+        for(asUINT i = 0; i < messages.size(); ++i)
+            ((std::string*)errors->At(i))->swap(messages[i]);
 
-        std::string key(CleanString(stream.front(), stream.back()));
+        return r;
+    }
+    catch(std::exception & e)
+    {
+        asGetActiveContext()->SetException(e.what());
+    }
 
-        stream.popFront();
+    return nullptr;
+}
 
-        if(stream.empty() || *stream.front() != ':')
-            throw std::runtime_error("expected ':' found EOF");
+/* content hash and atomic save */
 
-        stream.popFront();
+//streaming XXH64, seed 0.
+class JSONHasher
+{
+public:
+    void Update(const char * data, size_t size)
+    {
+        total += size;
 
-        if(stream.empty())
-            throw std::runtime_error("expected value found EOF");
+        if(used + size < sizeof(buffer))
+        {
+            memcpy(buffer + used, data, size);
+            used += size;
+            return;
+        }
 
-        JSON_ANY value{};
-        int asTypeId{};
-        asFromJSON_String(stream, value, asTypeId);
+        const char * end = data + size;
 
-        if(asTypeId == asTYPEID_INT64)
+        if(used)
         {
-            dict->Set(key, value._int);
+            size_t n = sizeof(buffer) - used;
+            memcpy(buffer + used, data, n);
+            data += n;
+            Consume(buffer);
+            used = 0;
         }
-        else if(asTypeId == asTYPEID_DOUBLE)
+
+        for(; end - data >= 32; data += 32)
+            Consume(data);
+
+        used = end - data;
+        memcpy(buffer, data, used);
+    }
+
+    uint64_t Digest() const
+    {
+        uint64_t h;
+
+        if(total >= 32)
         {
-            dict->Set(key, value.dbl);
+            h = Rotl(v[0], 1) + Rotl(v[1], 7) + Rotl(v[2], 12) + Rotl(v[3], 18);
+
+            for(uint64_t lane : v)
+                h = (h ^ Round(0, lane)) * P1 + P4;
         }
         else
+            h = P5;
+
+        h += total;
+
+        const char * p = buffer, * end = buffer + used;
+
+        for(; end - p >= 8; p += 8)
+            h = Rotl(h ^ Round(0, Read<uint64_t>(p)), 27) * P1 + P4;
+
+        if(end - p >= 4)
         {
-            dict->Set(key, value.obj, asTypeId);
-            stream.engine->ReleaseScriptObject(value.obj, stream.engine->GetTypeInfoById(asTypeId));
+            h = Rotl(h ^ (Read<uint32_t>(p) * P1), 23) * P2 + P3;
+            p += 4;
         }
 
-        stream.popFront();
-
-        if(stream.empty() || !JSONTokenRange::ischar(*stream.front(), ",}"))
-            throw std::runtime_error("expected ',' or '}' found EOF");
+        for(; p < end; ++p)
+            h = Rotl(h ^ ((unsigned char)*p * P5), 11) * P1;
 
-        if(*stream.front() == '}')
-            break;
+        h ^= h >> 33;
+        h *= P2;
+        h ^= h >> 29;
+        h *= P3;
+        h ^= h >> 32;
+        return h;
     }
-}
 
-static void asFromJSON_String(JSONTokenRange & stream, CScriptArray *& array)
-{
-    assert(strcmp(stream.front(), "[") == 0);
+    uint64_t Size() const { return total; }
+
+private:
+    static const uint64_t P1 = 0x9E3779B185EBCA87ull;
+    static const uint64_t P2 = 0xC2B2AE3D27D4EB4Full;
+    static const uint64_t P3 = 0x165667B19E3779F9ull;
+    static const uint64_t P4 = 0x85EBCA77C2B2AE63ull;
+    static const uint64_t P5 = 0x27D4EB2F165667C5ull;
 
-    std::vector<std::pair<JSON_ANY, int> > vec;
+    static uint64_t Rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+    static uint64_t Round(uint64_t acc, uint64_t lane) { return Rotl(acc + lane * P2, 31) * P1; }
 
-    try
+//the spec reads little endian, which is every platform this runs on.
+    template<typename T>
+    static uint64_t Read(const char * p) { T r; memcpy(&r, p, sizeof(r)); return r; }
+
+    void Consume(const char * p)
     {
-        while(!stream.empty())
-        {
-            stream.popFront();
+        for(int i = 0; i < 4; ++i)
+            v[i] = Round(v[i], Read<uint64_t>(p + i*8));
+    }
 
-            if(stream.empty())
-                throw std::runtime_error("expected item found EOF");
+    uint64_t v[4]{P1 + P2, P2, 0, 0 - P1};
+    uint64_t total{};
+    char     buffer[32];
+    size_t   used{};
+};
 
-    //not strictly correct but i don't really care.
-            if(*stream.front() == ']')
-                break;
+//file created next to the target and renamed over it, so an interrupted save leaves the old file alone.
+class JSONTempFile
+{
+public:
+    explicit JSONTempFile(std::string const& target) : target(target)
+    {
+        static std::atomic<unsigned> counter{0};
 
-            JSON_ANY value{};
-            int asTypeId{};
+//exclusive create, so neither a concurrent save of the same path nor a stray file can be clobbered.
+        for(int attempt = 0; ; ++attempt)
+        {
+#ifdef _WIN32
+            name = target + "." + std::to_string(GetCurrentProcessId()) + "." + std::to_string(counter++) + ".tmp";
+            handle = CreateFileA(name.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
 
-            asFromJSON_String(stream, value, asTypeId);
-            vec.push_back({value, asTypeId});
-            assert(vec.back().first.obj == value.obj);
+            if(handle != INVALID_HANDLE_VALUE)
+                return;
 
-            stream.popFront();
+            DWORD error = GetLastError();
 
-            if(stream.empty() || !JSONTokenRange::ischar(*stream.front(), ",]"))
-                throw std::runtime_error("expected ',' or ']' found EOF");
+            if(error != ERROR_FILE_EXISTS || attempt == 100)
+                throw std::system_error((int)error, std::system_category(), target);
+#else
+            name = target + "." + std::to_string(getpid()) + "." + std::to_string(counter++) + ".tmp";
+            fd = open(name.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
 
-            if(*stream.front() == ']')
-                break;
-        }
+            if(fd >= 0)
+                return;
 
-        if(vec.empty())
-        {
-            array = nullptr;
-            return;
+            if(errno != EEXIST || attempt == 100)
+                throw std::system_error(errno, std::generic_category(), target);
+#endif
         }
+    }
+
+    ~JSONTempFile()
+    {
+        Close();
 
-        int cur_type = vec[0].second;
+        if(!committed)
+            std::remove(name.c_str());
+    }
 
-        for(asUINT i = 1; i < vec.size(); ++i)
+    void Write(const char * data, size_t size)
+    {
+        while(size)
         {
-            if(cur_type != vec[i].second)
-            {
-                if(cur_type == asTYPEID_DOUBLE && vec[i].second == asTYPEID_INT64)
-                {
-                    vec[i].first.dbl = vec[i].first._int;
-                    vec[i].second = asTYPEID_DOUBLE;
-                    continue;
-                }
+#ifdef _WIN32
+            DWORD written{};
+            if(!WriteFile(handle, data, (DWORD)std::min<size_t>(size, 1u << 30), &written, nullptr))
+                throw std::system_error((int)GetLastError(), std::system_category(), target);
+#else
+            ssize_t written = write(fd, data, size);
 
-                if(cur_type == asTYPEID_INT64 && vec[i].second == asTYPEID_DOUBLE)
-                {
-                    cur_type = asTYPEID_DOUBLE;
-                    i = -1;
+            if(written < 0)
+            {
+                if(errno == EINTR)
                     continue;
-                }
 
-
-                FreePairVec(stream.engine, std::move(vec));
-                throw std::runtime_error("type mismatch: all entries in array must have same asTYPEID.");
+                throw std::system_error(errno, std::generic_category(), target);
             }
+#endif
+            data += written;
+            size -= written;
         }
+    }
+
+//the contents have to be on disk before the rename, or a power cut can leave the target empty.
+    void Commit()
+    {
+#ifdef _WIN32
+        if(!FlushFileBuffers(handle))
+            throw std::system_error((int)GetLastError(), std::system_category(), target);
 
-        std::string type_name = "array<" + GetFullTypeName(stream.engine, cur_type) + ">";
+        Close();
 
-        auto typeInfo = stream.engine->GetTypeInfoByDecl(type_name.c_str());
-        assert(typeInfo && (typeInfo->GetSubTypeId() == cur_type || typeInfo->GetSubTypeId() == (cur_type | asTYPEID_OBJHANDLE)));
+        if(!MoveFileExA(name.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+            throw std::system_error((int)GetLastError(), std::system_category(), target);
 
-        array = CScriptArray::Create(typeInfo, vec.size());
+        committed = true;
+#else
+        if(fsync(fd) != 0)
+            throw std::system_error(errno, std::generic_category(), target);
+
+        Close();
+
+        if(std::rename(name.c_str(), target.c_str()) != 0)
+            throw std::system_error(errno, std::generic_category(), target);
+
+        committed = true;
 
-        auto subType = array->GetArrayObjectType()->GetSubType();
-        bool is_value = subType? subType->GetFlags() & asOBJ_VALUE : false;
+//and the rename itself is only durable once the directory is.
+        size_t slash = target.find_last_of('/');
+        std::string dir = slash == std::string::npos? "." : slash == 0? "/" : target.substr(0, slash);
 
-        for(asUINT i = 0; i < vec.size(); ++i)
+        int dir_fd = open(dir.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if(dir_fd >= 0)
         {
-            array->SetValue(i, is_value? vec[i].first.obj : &vec[i].first);
-            stream.engine->ReleaseScriptObject(vec[i].first.obj, subType);
-            vec[i].first.obj = nullptr;
+            fsync(dir_fd);
+            close(dir_fd);
         }
+#endif
     }
-    catch(std::exception & e)
+
+private:
+    void Close()
     {
-        FreePairVec(stream.engine, std::move(vec));
-        throw;
+#ifdef _WIN32
+        if(handle != INVALID_HANDLE_VALUE)
+            CloseHandle(handle);
+
+        handle = INVALID_HANDLE_VALUE;
+#else
+        if(fd >= 0)
+            close(fd);
+
+        fd = -1;
+#endif
     }
 
-}
+    std::string const target;
+    std::string       name;
+#ifdef _WIN32
+    HANDLE            handle{INVALID_HANDLE_VALUE};
+#else
+    int               fd{-1};
+#endif
+    bool              committed{};
+};
 
-const char * GetPrimitiveTypeName(int typeId)
+//hashes everything written through it, and passes it on to file if there is one.
+class JSONHashBuf : public std::streambuf
 {
-    switch(typeId)
+public:
+    explicit JSONHashBuf(JSONTempFile * file = nullptr) : file(file) { setp(buffer, buffer + sizeof(buffer)); }
+
+    JSONHasher const& Finish()
     {
-    case asTYPEID_VOID: return "void";
-    case asTYPEID_INT8: return "int8";
-    case asTYPEID_INT16: return "int16";
-    case asTYPEID_INT32: return "int";
-    case asTYPEID_INT64: return "int64";
-    case asTYPEID_UINT8: return "uint8";
-    case asTYPEID_UINT16: return "uint16";
-    case asTYPEID_UINT32: return "uint";
-    case asTYPEID_UINT64: return "uint64";
-    case asTYPEID_FLOAT: return "float";
-    case asTYPEID_DOUBLE: return "double";
-    default:
-        break;
+        Flush();
+        return hasher;
     }
 
-    return "";
-}
+protected:
+    int overflow(int c) override
+    {
+        Flush();
 
-std::string GetFullTypeName(asIScriptEngine * engine, int typeId)
-{
-    auto op = GetPrimitiveTypeName(typeId);
-    if(*op) return op;
+        if(c != traits_type::eof())
+        {
+            *pptr() = (char)c;
+            pbump(1);
+        }
 
-    auto typeInfo = engine->GetTypeInfoById(typeId);
+        return traits_type::not_eof(c);
+    }
 
-    if(!typeInfo)
+private:
+    void Flush()
     {
-        return "void";
+        hasher.Update(pbase(), pptr() - pbase());
+
+        if(file)
+            file->Write(pbase(), pptr() - pbase());
+
+        setp(buffer, buffer + sizeof(buffer));
     }
 
-    std::string name = typeInfo->GetName();
+    JSONTempFile * file;
+    JSONHasher     hasher;
+    char           buffer[1 << 16];
+};
 
-    if(typeInfo->GetFlags() & asOBJ_TEMPLATE)
-    {
-        name += "<";
+static JSONHasher HashJSON(asIScriptEngine * engine, void const* ref, int typeId, bool compressWhitespace)
+{
+    JSONHashBuf buf;
+    std::ostream stream(&buf);
 
-        for(asUINT i = 0; i < typeInfo->GetSubTypeCount(); ++i)
-        {
-            name += GetFullTypeName(engine, typeInfo->GetSubTypeId(i));
+    stream.exceptions( std::iostream::failbit | std::iostream::badbit );
 
-            if(i+1 < typeInfo->GetSubTypeCount())
-            {
-                name += ", ";
-            }
-        }
+    stream.imbue(std::locale("C"));
 
-        name += ">";
-    }
+    asToJSON_String(stream, engine, ref, typeId, compressWhitespace);
 
-    if(!(typeInfo->GetFlags() & asOBJ_VALUE))
-        return name + "@";
+    return buf.Finish();
+}
 
-    return name;
+uint64_t asJSONHash(CScriptDictionary const* dict, bool compressWhitespace)
+{
+    if(dict == nullptr)
+        throw std::invalid_argument("null dictionary");
+
+    asIScriptEngine * engine = dict->GetEngine();
+    return HashJSON(engine, dict, engine->GetTypeIdByDecl("dictionary"), compressWhitespace).Digest();
 }
 
-void FreePairVec(asIScriptEngine * engine, std::vector<std::pair<JSON_ANY, int> > vec)
+//what the last save (or check) found in each file, so an unchanged save doesn't have to read the file back.
+struct JSONSavedFile
 {
-    for(asUINT i = 0; i < vec.size(); ++i)
-    {
-        engine->ReleaseScriptObject(vec[i].first.obj, engine->GetTypeInfoById(vec[i].second));
-    }
+    int64_t  mtime;
+    size_t   size;
+    uint64_t digest;
+};
+
+static std::mutex g_SavedFilesMutex;
+static std::unordered_map<std::string, JSONSavedFile> g_SavedFiles;
+
+static void RememberContent(std::string const& path, uint64_t digest)
+{
+    JSONSavedFile saved{0, 0, digest};
+
+    std::lock_guard<std::mutex> lock(g_SavedFilesMutex);
+
+    if(JSONFileCache::Stat(path, saved.mtime, saved.size))
+        g_SavedFiles[path] = saved;
+    else
+        g_SavedFiles.erase(path);
 }
 
-std::string CleanString(const char * input, const char * end)
+//the size is checked first, most changed files don't need reading at all. If the file hasn't been touched since
+//it was last saved or checked its digest is already known, otherwise it is read and hashed.
+static bool FileHasContent(std::string const& path, JSONHasher const& expected)
 {
-    bool in_escape = false;
+    int64_t mtime{};
+    size_t  size{};
 
-    std::string r;
+    if(!JSONFileCache::Stat(path, mtime, size) || size != expected.Size())
+        return false;
 
-    for(auto p = input+1; p < (end-1); ++p)
     {
-        if(in_escape && *p == *input)
-        {
-            r.back() = *p;
-            continue;
-        }
+        std::lock_guard<std::mutex> lock(g_SavedFilesMutex);
+        auto itr = g_SavedFiles.find(path);
 
-        in_escape = (*p == '\\');
-        r.push_back(*p);
+        if(itr != g_SavedFiles.end() && itr->second.mtime == mtime && itr->second.size == size)
+            return itr->second.digest == expected.Digest();
     }
 
-    return r;
-}
+    std::ifstream stream(path, std::ios::binary);
 
-#ifdef _WIN32
-#define LONG_INT_SPEC "%lld"
-#else
-#define LONG_INT_SPEC "%ld"
-#endif
+    if(!stream.is_open())
+        return false;
 
-static void asFromJSON_String(JSONTokenRange & stream, JSON_ANY & value, int & typeId)
-{
-    if(strcmp(stream.front(), "true") == 0)
+    JSONHasher hasher;
+    char buffer[1 << 16];
+
+    while(stream)
     {
-        value.boolean = true;
-        typeId     = asTYPEID_BOOL;
-        return;
+        stream.read(buffer, sizeof(buffer));
+        hasher.Update(buffer, (size_t)stream.gcount());
     }
-    if(strcmp(stream.front(), "false") == 0)
+
+    if(hasher.Size() != expected.Size())
+        return false;
+
     {
-        value.boolean = false;
-        typeId     = asTYPEID_BOOL;
-        return;
+        std::lock_guard<std::mutex> lock(g_SavedFilesMutex);
+        g_SavedFiles[path] = JSONSavedFile{mtime, size, hasher.Digest()};
     }
 
-    if(('0' <= *stream.front() && *stream.front() <= '9') || JSONTokenRange::ischar(*stream.front(), ".-+eE"))
-    {
-        auto p = stream.front();
+    return hasher.Digest() == expected.Digest();
+}
 
-        bool is_float = false;
-        for(; *p != 0; ++p)
-        {
-            if(*p == '.' || tolower(*p) == 'e')
-            {
-                is_float = true;
-            }
-        }
+bool asToJSON_File(std::string const& path, CScriptDictionary const* dict, bool skipUnchanged)
+{
+    if(dict == nullptr)
+        throw std::invalid_argument("null dictionary");
 
-        if(!is_float)
-        {
-            sscanf(stream.front(), LONG_INT_SPEC, &value._int);
-            typeId = asTYPEID_INT64;
-            return;
-        }
+    asIScriptEngine * engine = dict->GetEngine();
+    return asToJSON_File(path, engine, dict, engine->GetTypeIdByDecl("dictionary"), skipUnchanged);
+}
 
+bool asToJSON_File(std::string const& path, asIScriptEngine * engine, void const* ref, int typeId, bool skipUnchanged)
+{
+    CheckDocumentRoot(engine, ref, typeId);
 
-        sscanf(stream.front(), "%lf", &value.dbl);
-        typeId = asTYPEID_DOUBLE;
-        return;
-    }
+//hashing costs a second serialization when the content did change, but an unchanged save touches nothing on disk.
+    if(skipUnchanged && FileHasContent(path, HashJSON(engine, ref, typeId, false)))
+        return false;
 
-    if(JSONTokenRange::ischar(*stream.front(), "'\"`"))
-    {
-        auto content = CleanString(stream.front(), stream.back());
-		auto typeInfo = stream.engine->GetTypeInfoById(stream.engine->GetStringFactory(nullptr, nullptr));
+    JSONTempFile file(path);
+    JSONHashBuf buf(&file);
 
-        value.obj  = stream.engine->CreateScriptObjectCopy(&content, typeInfo);
-        typeId     = stream.asTypeIdString;
+    {
+        std::ostream stream(&buf);
 
-        return;
-    }
+        stream.exceptions( std::iostream::failbit | std::iostream::badbit );
 
-    if(*stream.front() == '[')
-    {
-        CScriptArray * array{};
-        asFromJSON_String(stream, array);
+        stream.imbue(std::locale("C"));
 
-        value.obj = array;
-        typeId    = array->GetArrayTypeId();
-        return;
+        asToJSON_String(stream, engine, ref, typeId, false);
     }
 
-    if(*stream.front() == '{')
-    {
-        CScriptDictionary * dict{};
-
-        try
-        {
-            dict = CScriptDictionary::Create(stream.engine);
-            asFromJSON_String(stream, dict);
-        }
-        catch(std::exception & e)
-        {
-            dict->Release();
-            throw;
-        }
+    uint64_t digest = buf.Finish().Digest();
 
-        value.obj = dict;
-        typeId    = stream.asTypeIdDictionary;
-        return;
-    }
+    file.Commit();
+    RememberContent(path, digest);
 
-    throw std::runtime_error("unexpected token: " + std::string(stream.front()));
+//don't rely on the mtime check alone, a load in the same clock tick would get the old tree.
+    InvalidateCachedFile(engine, path);
+    return true;
 }
-
@@ -1,18 +1,105 @@
 #ifndef DICTIONARY_EXTENSIONS_H
 #define DICTIONARY_EXTENSIONS_H
 #include <string>
+#include <cstdint>
+#include <vector>
 
 class asIScriptEngine;
 class asDocumenter;
 class CScriptDictionary;
+class CScriptArray;
 
 typedef std::string (*StringNormalizeFunc)(std::string const&);
+//return false if data is already normalized, otherwise write the normalized text to out and return true.
+typedef bool (*StringNormalizeViewFunc)(const char * data, size_t length, std::string & out);
+typedef void * (*JSONAllocFunc)(size_t size, void * userData);
+typedef void   (*JSONFreeFunc)(void * ptr, void * userData);
 
 void asRegisterDictionaryExtensions(asIScriptEngine * engine, StringNormalizeFunc UnicodeNormalization = nullptr, StringNormalizeFunc PathNormalization = nullptr);
 
+//preferred over the StringNormalizeFunc hooks, nothing is copied unless the hook changes something.
+//skipAscii: 7 bit strings are the same in every normalization form, so don't call the unicode hook for them.
+//cacheEntries: remember up to this many unicode results per thread (keys repeat a lot), 0 turns the cache off.
+void asSetDictionaryNormalization(StringNormalizeViewFunc UnicodeNormalization, StringNormalizeViewFunc PathNormalization = nullptr, size_t cacheEntries = 0, bool skipAscii = true);
+
+struct JSONFileCacheStats
+{
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    size_t entries;
+    size_t bytes;
+};
+
+//opt in to sharing parsed files between FromJsonFile calls on this engine, entries are checked against the file's mtime and size.
+//maxBytes bounds the summed size of the cached files on disk (least recently used go first), 0 turns the cache off again.
+//it doesn't measure the parsed trees, which take several times the file size in memory.
+void asEnableJSONFileCache(asIScriptEngine * engine, size_t maxBytes);
+//drop one file from the cache, or everything if path is empty.
+void asInvalidateJSONFileCache(asIScriptEngine * engine, std::string const& path = std::string());
+JSONFileCacheStats asGetJSONFileCacheStats(asIScriptEngine * engine);
+
+enum class JSONUTF8Mode : unsigned char
+{
+//strings go through unchecked.
+    Accept,
+//the document fails to load, the error gives the byte offset.
+    Reject,
+//each invalid sequence becomes U+FFFD.
+    Replace,
+//invalid sequences are dropped.
+    Skip
+};
+
+//a document breaking one of these fails to load with an error instead of exhausting memory; 0 means no limit for maxBytes and maxElements.
+struct JSONParseLimits
+{
+//saving, comparing, copying and typed loads recurse per level, this keeps them well inside a 1MB stack.
+    static constexpr size_t maxSupportedDepth{2048};
+//levels of nested objects/arrays, the document itself is level 1. Must be 1..maxSupportedDepth,
+//the limit set with asSetJSONParseLimits also stops saving, diffing and copying values nested deeper than this.
+    size_t maxDepth{512};
+    size_t maxBytes{0};
+//values of any kind, keys aren't counted.
+    size_t maxElements{0};
+//what to do with strings (and keys) that aren't valid UTF-8.
+    JSONUTF8Mode utf8{JSONUTF8Mode::Accept};
+};
+
+//limits used by the script functions and the two argument asFromJSON_String.
+void asSetJSONParseLimits(JSONParseLimits const& limits);
+JSONParseLimits asGetJSONParseLimits();
+
+//scratch memory for parsing/saving is taken from a per-thread arena, the arena gets its blocks from here (default malloc/free).
+void asSetJSONAllocator(JSONAllocFunc alloc, JSONFreeFunc free, void * userData = nullptr);
+//give the calling thread's scratch blocks back to the allocator.
+void asReleaseJSONScratch();
+
 void asToJSON_String(std::ostream & stream, CScriptDictionary const* dict, bool compressWhitespace);
+//XXH64 of what asToJSON_String would write, without keeping the text.
+uint64_t asJSONHash(CScriptDictionary const* dict, bool compressWhitespace);
+//writes to a uniquely named temporary file next to path, flushes it and renames it over path. With skipUnchanged nothing is written if path already holds the same bytes.
+//path is used as given (the path hook isn't applied), the FromJsonFile cache entry under that exact path is dropped.
+//returns false if the write was skipped.
+bool asToJSON_File(std::string const& path, CScriptDictionary const* dict, bool skipUnchanged);
+//write the object at ref (typeId as from a ?& argument) as the document itself, the counterpart of loading into an object.
+//it has to be a dictionary, a script object or a value type with registered properties.
+void asToJSON_String(std::ostream & stream, asIScriptEngine * engine, void const* ref, int typeId, bool compressWhitespace);
+bool asToJSON_File(std::string const& path, asIScriptEngine * engine, void const* ref, int typeId, bool skipUnchanged);
 //ifstream is just the wrong base class to tokenize from
-CScriptDictionary * asFromJSON_String(std::string stream, asIScriptEngine * engine);
+CScriptDictionary * asFromJSON_String(std::string const& stream, asIScriptEngine * engine);
+CScriptDictionary * asFromJSON_String(std::string const& stream, asIScriptEngine * engine, JSONParseLimits const& limits);
+//reads and tokenizes the files on the worker pool, the result is array<dictionary@> in the same order with null for files that failed.
+//errors, if given, gets one entry per path: empty on success, otherwise why that file failed.
+CScriptArray * asFromJSON_Files(std::vector<std::string> const& paths, asIScriptEngine * engine, std::vector<std::string> * errors = nullptr);
+//fills the object at ref (typeId as from a ?& argument) from matching keys, other keys are skipped. Throws on a type mismatch.
+//false if the document isn't a JSON object.
+bool asFromJSON_String(std::string const& stream, asIScriptEngine * engine, void * ref, int typeId);
 bool CanSerializeDictionary(CScriptDictionary const* dict);
 
+//writes the RFC 6902 JSON Patch that turns a into b.
+void asJSONDiff(std::ostream & stream, CScriptDictionary const* a, CScriptDictionary const* b);
+//applies an RFC 6902 JSON Patch in place, throws on the first operation that fails (earlier ones stay applied).
+void asJSONApplyPatch(CScriptDictionary * dict, std::string patch);
+
 #endif // DICTIONARY_EXTENSIONS_H